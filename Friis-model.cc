@@ -5,6 +5,10 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/propagation-module.h"
 #include "ns3/olsr-helper.h"
+#include "grid-wifi-channel.h"
+#include "cached-loss-model.h"
+#include "packet-pool.h"
+#include "run-stats.h"
 
 using namespace ns3;
 using namespace std;
@@ -16,7 +20,7 @@ NS_LOG_COMPONENT_DEFINE ("FriisPropagationLoss");
 
 static void GenerateTraffic (Ptr<Socket> socket, uint32_t pktSize, uint32_t pktCount, Time pktInterval ) {
   if (pktCount > 0) {
-      socket->Send (Create<Packet> (pktSize));
+      socket->Send (PacketPool::Default ().Allocate (pktSize));
       Simulator::Schedule (pktInterval, &GenerateTraffic,
                            socket, pktSize,pktCount - 1, pktInterval);
     } else {
@@ -24,6 +28,17 @@ static void GenerateTraffic (Ptr<Socket> socket, uint32_t pktSize, uint32_t pktC
     }
 }
 
+static uint64_t g_received = 0;
+
+//Drains the sink and hands the payloads back to the sender
+static void ReceivePacket (Ptr<Socket> socket) {
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ())) {
+    g_received++;
+    PacketPool::Default ().Recycle (packet);
+  }
+}
+
 int main (int argc, char *argv[]) {
   string phyMode ("DsssRate11Mbps");
   double distance = 500;
@@ -46,7 +61,7 @@ int main (int argc, char *argv[]) {
   WifiHelper wifi;
   wifi.SetStandard(WIFI_PHY_STANDARD_80211b);
 
-  YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default ();
+  GridWifiPhyHelper wifiPhy (YansWifiPhyHelper::Default ());
   wifiPhy.Set ("RxGain", DoubleValue(0)); //no gain
   wifiPhy.SetPcapDataLinkType (YansWifiPhyHelper::DLT_IEEE802_11_RADIO);
   WifiMacHelper wifiMac;
@@ -58,12 +73,20 @@ int main (int argc, char *argv[]) {
   Ptr<FriisPropagationLossModel> lossModel = CreateObject<FriisPropagationLossModel> ();
 //  lossModel->SetMinLoss (loss); // set default loss to 3 dB
   lossModel->SetFrequency(freq); //802.11B is 2.4 GHz
-  Ptr<YansWifiChannel> wifiChannel = CreateObject <YansWifiChannel> ();
-  wifiChannel->SetPropagationLossModel (lossModel);
+  //Both nodes are static, so the path loss is computed once and cached
+  Ptr<CachedPropagationLossModel> cache = CreateObject<CachedPropagationLossModel> ();
+  cache->SetCachedModel (lossModel);
+  //With one receiver the batch kernel saves nothing and would bypass the
+  //cache, so the channel asks the chain per receiver
+  Ptr<GridWifiChannel> wifiChannel = CreateObject <GridWifiChannel> ();
+  wifiChannel->SetAttribute ("BatchLoss", BooleanValue (false));
+  wifiChannel->SetPropagationLossModel (cache);
   wifiChannel->SetPropagationDelayModel (CreateObject <ConstantSpeedPropagationDelayModel> ());
   wifiPhy.SetChannel(wifiChannel);
 
   NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, nodes);
+  RunStats runStats;
+  runStats.Install ();
 
   //Configures position of nodes
   MobilityHelper mobility;
@@ -93,6 +116,7 @@ int main (int argc, char *argv[]) {
   Ptr<Socket> recvSink = Socket::CreateSocket (nodes.Get (1), tid);
   InetSocketAddress local = InetSocketAddress (Ipv4Address::GetAny (), 80);
   recvSink->Bind (local);
+  recvSink->SetRecvCallback (MakeCallback (&ReceivePacket));
   Ptr<Socket> source = Socket::CreateSocket (nodes.Get (0), tid);
   InetSocketAddress remote = InetSocketAddress (i.GetAddress (1, 0), 80);
   source->SetAllowBroadcast (true);
@@ -109,7 +133,11 @@ int main (int argc, char *argv[]) {
   NS_LOG_UNCOND ("Testing Transmission at distance " << distance);
   //Runs the simulation for '25' seconds
   Simulator::Stop (Seconds (505.0));
+  runStats.Start ();
   Simulator::Run ();
+  runStats.Print (cout, g_received);
+  cout << "Path loss cache: " << cache->GetHits () << " hits, " << cache->GetMisses () << " misses\n";
+  PacketPool::Default ().Print (cout);
 
   //Print chosen flow monitor statistics
   monitor->CheckForLostPackets ();
@@ -129,7 +157,9 @@ int main (int argc, char *argv[]) {
     Time max = delay + jitter;
     Time avg = 1000*(delay/distance);
     uint32_t lost = i->second.lostPackets;
-    uint32_t through = (8*r_byte)/delay.GetSeconds();
+    //Goodput: bits received over the time from the first send to the last receive
+    Time active = i->second.timeLastRxPacket - i->second.timeFirstTxPacket;
+    uint32_t through = active.IsStrictlyPositive () ? (8*r_byte)/active.GetSeconds() : 0;
     cout << "Flow (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
     cout << "\n FLOW MONITOR METRICS:\n";
     cout << "1.Tx Packets:           " << t_packet << "\n";
@@ -140,10 +170,10 @@ int main (int argc, char *argv[]) {
     cout << "6.Jitter Sum:           " << jitter.As (Time::S) << "\n";
     cout << "7.Lost Packets:         " << lost << "\n";
     cout << "\n CUSTOM METRICS:\n";
-    cout << "1.Throughput:           " << through << "bps \n";
+    cout << "1.Goodput:              " << through << "bps \n";
     cout << "THROUGH DIST            " << through/distance << "\n";
     cout << "2.Link Utilization:     " << through/110000 << "% \n";
-    cout << "3.Mean Delay:           " << delay/r_byte << "\n";
+    cout << "3.Mean Delay:           " << (r_packet > 0 ? delay/r_packet : Time (0)).As (Time::S) << "\n";
     cout << "AVG DELAY:              " << avg.As (Time::S) << "\n";
     cout << "4.Minimum Delay:        " << min.As (Time::S) << "\n";
     cout << "5.Maximum Delay:        " << max.As (Time::S) << "\n";
@@ -0,0 +1,58 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+//Counts every operator new of the program, ns-3 libraries included, by
+//replacing the global operator new/delete with malloc/free wrappers. The
+//replacements are ordinary definitions, so include this header from one
+//translation unit per program (run-stats.h does).
+
+static std::atomic<uint64_t> g_allocations (0);
+
+inline uint64_t GetAllocationCount () {
+  return g_allocations.load (std::memory_order_relaxed);
+}
+
+void *operator new (std::size_t size) {
+  g_allocations.fetch_add (1, std::memory_order_relaxed);
+  void *p = std::malloc (size ? size : 1);
+  if (p == 0) {
+    throw std::bad_alloc ();
+  }
+  return p;
+}
+
+void *operator new[] (std::size_t size) {
+  return operator new (size);
+}
+
+void *operator new (std::size_t size, const std::nothrow_t &) noexcept {
+  g_allocations.fetch_add (1, std::memory_order_relaxed);
+  return std::malloc (size ? size : 1);
+}
+
+void *operator new[] (std::size_t size, const std::nothrow_t &tag) noexcept {
+  return operator new (size, tag);
+}
+
+void operator delete (void *p) noexcept {
+  std::free (p);
+}
+
+void operator delete[] (void *p) noexcept {
+  std::free (p);
+}
+
+void operator delete (void *p, const std::nothrow_t &) noexcept {
+  std::free (p);
+}
+
+void operator delete[] (void *p, const std::nothrow_t &) noexcept {
+  std::free (p);
+}
+
+#endif /* ALLOC_COUNTER_H */
@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-module.h"
+#include "batch-loss.h"
+
+using namespace ns3;
+using namespace std;
+
+NS_LOG_COMPONENT_DEFINE ("BatchLossBench");
+
+//One transmitter, n receivers
+//Scalar CalcRxPower chain vs. BatchLoss for Friis and Nakagami -> Friis
+
+//Returns nanoseconds per receiver of the scalar chain
+static double TimeScalar (Ptr<PropagationLossModel> model, Ptr<MobilityModel> tx,
+                          vector<Ptr<MobilityModel> > &rx, uint32_t reps, vector<double> &out) {
+  out.resize (rx.size ());
+  chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+  for (uint32_t r = 0; r < reps; r++) {
+    for (uint32_t i = 0; i < rx.size (); i++) {
+      out[i] = model->CalcRxPower (15, tx, rx[i]);
+    }
+  }
+  chrono::duration<double, nano> ns = chrono::steady_clock::now () - start;
+  return ns.count () / (reps * rx.size ());
+}
+
+//Returns nanoseconds per receiver of the batch kernel, position gather included
+static double TimeBatch (Ptr<BatchLoss> batch, Ptr<MobilityModel> tx,
+                         vector<Ptr<MobilityModel> > &rx, uint32_t reps, vector<double> &out) {
+  PositionBatch positions;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+  for (uint32_t r = 0; r < reps; r++) {
+    positions.Clear ();
+    for (uint32_t i = 0; i < rx.size (); i++) {
+      positions.Add (rx[i]->GetPosition ());
+    }
+    batch->CalcRxPower (15, tx->GetPosition (), positions, out);
+  }
+  chrono::duration<double, nano> ns = chrono::steady_clock::now () - start;
+  return ns.count () / (reps * rx.size ());
+}
+
+static void Report (string name, double scalar, double batch) {
+  cout << name << " scalar: " << scalar << " ns/rx, batch: " << batch
+       << " ns/rx, speedup: " << scalar / batch << "x\n";
+}
+
+int main (int argc, char *argv[]) {
+  uint32_t nodes = 1000;
+  uint32_t reps = 1000;
+  double size = 1000;
+  double freq = 2400000000;
+
+  CommandLine cmd;
+  cmd.AddValue ("nodes", "number of receivers", nodes);
+  cmd.AddValue ("reps", "transmissions to time", reps);
+  cmd.AddValue ("size", "side of the square the receivers are placed in", size);
+  cmd.Parse (argc, argv);
+
+  //Receivers at random positions around a transmitter in the middle
+  Ptr<UniformRandomVariable> place = CreateObject<UniformRandomVariable> ();
+  Ptr<MobilityModel> tx = CreateObject<ConstantPositionMobilityModel> ();
+  tx->SetPosition (Vector (size / 2, size / 2, 0));
+  vector<Ptr<MobilityModel> > rx;
+  for (uint32_t i = 0; i < nodes; i++) {
+    Ptr<MobilityModel> m = CreateObject<ConstantPositionMobilityModel> ();
+    m->SetPosition (Vector (place->GetValue (0, size), place->GetValue (0, size), 0));
+    rx.push_back (m);
+  }
+
+  //Same chains as Friis-model.cc and lab1/Nakagami-model.cc
+  Ptr<FriisPropagationLossModel> friis = CreateObject<FriisPropagationLossModel> ();
+  friis->SetFrequency (freq);
+  Ptr<FriisPropagationLossModel> lossg = CreateObject<FriisPropagationLossModel> ();
+  lossg->SetMinLoss (3);
+  lossg->SetFrequency (freq);
+  Ptr<NakagamiPropagationLossModel> nkg = CreateObject<NakagamiPropagationLossModel> ();
+  nkg->SetNext (lossg);
+
+  cout << "kernel: " << simd::Name () << ", receivers: " << nodes << ", transmissions: " << reps << "\n";
+
+  vector<double> scalarOut, batchOut;
+  double scalar = TimeScalar (friis, tx, rx, reps, scalarOut);
+  double batch = TimeBatch (BatchLoss::FromModel (friis), tx, rx, reps, batchOut);
+  double maxErr = 0;
+  for (uint32_t i = 0; i < nodes; i++) {
+    maxErr = max (maxErr, fabs (scalarOut[i] - batchOut[i]));
+  }
+  Report ("Friis", scalar, batch);
+  cout << "Friis max |scalar - batch|: " << maxErr << " dB\n";
+
+  scalar = TimeScalar (nkg, tx, rx, reps, scalarOut);
+  batch = TimeBatch (BatchLoss::FromModel (nkg), tx, rx, reps, batchOut);
+  double scalarMean = 0, batchMean = 0;
+  for (uint32_t i = 0; i < nodes; i++) {
+    scalarMean += pow (10, scalarOut[i] / 10) / nodes;
+    batchMean += pow (10, batchOut[i] / 10) / nodes;
+  }
+  Report ("Nakagami->Friis", scalar, batch);
+  cout << "Nakagami->Friis mean rx power, scalar: " << 10 * log10 (scalarMean)
+       << " dBm, batch: " << 10 * log10 (batchMean) << " dBm\n";
+  return 0;
+}
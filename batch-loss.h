@@ -0,0 +1,249 @@
+#ifndef BATCH_LOSS_H
+#define BATCH_LOSS_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-loss-model.h"
+#include "simd-math.h"
+#include "cached-loss-model.h"
+
+namespace ns3 {
+
+//Receiver positions of one transmission, one array per coordinate
+class PositionBatch
+{
+public:
+  void Clear () {
+    x.clear ();
+    y.clear ();
+    z.clear ();
+  }
+  void Add (const Vector &pos) {
+    x.push_back (pos.x);
+    y.push_back (pos.y);
+    z.push_back (pos.z);
+  }
+  size_t GetN () const { return x.size (); }
+
+  std::vector<double> x;
+  std::vector<double> y;
+  std::vector<double> z;
+};
+
+//Evaluates FriisPropagationLossModel, optionally preceded by a
+//NakagamiPropagationLossModel, for one transmitter and many receivers in a
+//single call. Friis is computed as tx - max (K + 10 log10 (d^2), MinLoss)
+//with vector distance and log10 math. Nakagami fading is drawn with a
+//batched Marsaglia-Tsang gamma sampler (boosted for m < 1) from the batch's
+//own RNG streams, so it follows the same distribution as the scalar model
+//but not the same random sequence. Model parameters are read once, when the
+//batch is built from the chain. A CachedPropagationLossModel around Friis
+//is looked through; the kernel computes Friis itself.
+class BatchLoss : public SimpleRefCount<BatchLoss>
+{
+public:
+  BatchLoss ()
+    : m_offsetDb (0),
+      m_minLoss (0),
+      m_fading (false),
+      m_distance1 (0),
+      m_distance2 (0)
+  {
+  }
+
+  //Returns 0 unless the chain is Friis or Nakagami -> Friis, where Friis
+  //may be wrapped in a CachedPropagationLossModel with nothing after it
+  static Ptr<BatchLoss> FromModel (Ptr<PropagationLossModel> model);
+
+  void CalcRxPower (double txPowerDbm, const Vector &tx, const PositionBatch &rx, std::vector<double> &rxPowerDbm);
+  int64_t AssignStreams (int64_t stream);
+
+private:
+  void SetFriis (Ptr<FriisPropagationLossModel> friis);
+  void SetNakagami (Ptr<NakagamiPropagationLossModel> nakagami);
+  void AddFading (size_t n, double *rxPowerDbm);
+
+  double m_offsetDb;
+  double m_minLoss;
+  bool m_fading;
+  double m_distance1;
+  double m_distance2;
+  double m_shape[3];
+  double m_log10Shape[3];
+  double m_log10D[3];
+  Ptr<UniformRandomVariable> m_uniform;
+  Ptr<NormalRandomVariable> m_normal;
+  std::vector<double> m_d2;
+  std::vector<double> m_log;
+  std::vector<int> m_class;
+  std::vector<double> m_logGamma;
+  std::vector<uint32_t> m_pending;
+  std::vector<uint32_t> m_rejected;
+  std::vector<double> m_x;
+  std::vector<double> m_u;
+  std::vector<double> m_v;
+  std::vector<double> m_logU;
+  std::vector<double> m_logV;
+};
+
+inline Ptr<BatchLoss> BatchLoss::FromModel (Ptr<PropagationLossModel> model) {
+  if (model == 0) {
+    return 0;
+  }
+  Ptr<BatchLoss> batch = Create<BatchLoss> ();
+  Ptr<NakagamiPropagationLossModel> nakagami = DynamicCast<NakagamiPropagationLossModel> (model);
+  if (nakagami) {
+    batch->SetNakagami (nakagami);
+    model = model->GetNext ();
+  }
+  Ptr<CachedPropagationLossModel> cache = DynamicCast<CachedPropagationLossModel> (model);
+  if (cache && cache->GetNext () == 0) {
+    model = cache->GetCachedModel ();
+  }
+  Ptr<FriisPropagationLossModel> friis = DynamicCast<FriisPropagationLossModel> (model);
+  if (!friis || friis->GetNext () != 0) {
+    return 0;
+  }
+  batch->SetFriis (friis);
+  return batch;
+}
+
+inline void BatchLoss::SetFriis (Ptr<FriisPropagationLossModel> friis) {
+  double lambda = 299792458.0 / friis->GetFrequency ();
+  m_offsetDb = 10 * std::log10 (16 * M_PI * M_PI * friis->GetSystemLoss () / (lambda * lambda));
+  m_minLoss = friis->GetMinLoss ();
+}
+
+inline void BatchLoss::SetNakagami (Ptr<NakagamiPropagationLossModel> nakagami) {
+  DoubleValue value;
+  nakagami->GetAttribute ("Distance1", value);
+  m_distance1 = value.Get ();
+  nakagami->GetAttribute ("Distance2", value);
+  m_distance2 = value.Get ();
+  const char *names[3] = {"m0", "m1", "m2"};
+  for (int k = 0; k < 3; k++) {
+    nakagami->GetAttribute (names[k], value);
+    m_shape[k] = value.Get ();
+    m_log10Shape[k] = std::log10 (m_shape[k]);
+    m_log10D[k] = std::log10 ((m_shape[k] < 1 ? m_shape[k] + 1 : m_shape[k]) - 1.0 / 3);
+  }
+  m_uniform = CreateObject<UniformRandomVariable> ();
+  m_normal = CreateObject<NormalRandomVariable> ();
+  m_fading = true;
+}
+
+inline int64_t BatchLoss::AssignStreams (int64_t stream) {
+  if (!m_fading) {
+    return 0;
+  }
+  m_uniform->SetStream (stream);
+  m_normal->SetStream (stream + 1);
+  return 2;
+}
+
+inline void BatchLoss::CalcRxPower (double txPowerDbm, const Vector &tx, const PositionBatch &rx, std::vector<double> &rxPowerDbm) {
+  size_t n = rx.GetN ();
+  m_d2.resize (n);
+  m_log.resize (n);
+  rxPowerDbm.resize (n);
+  if (n == 0) {
+    return;
+  }
+  simd::Distance2 (tx.x, tx.y, tx.z, &rx.x[0], &rx.y[0], &rx.z[0], &m_d2[0], n);
+  //log10 (0) is replaced by the MinLoss branch below
+  for (size_t i = 0; i < n; i++) {
+    m_log[i] = m_d2[i] > 0 ? m_d2[i] : 1.0;
+  }
+  simd::Log10 (&m_log[0], &m_log[0], n);
+  for (size_t i = 0; i < n; i++) {
+    double loss = m_d2[i] > 0 ? std::max (m_offsetDb + 10 * m_log[i], m_minLoss) : m_minLoss;
+    rxPowerDbm[i] = txPowerDbm - loss;
+  }
+  if (m_fading) {
+    AddFading (n, &rxPowerDbm[0]);
+  }
+}
+
+//Nakagami power is Gamma (m, P/m), i.e. P * G / m with G ~ Gamma (m, 1),
+//so the fading is added in dB as 10 log10 (G / m)
+inline void BatchLoss::AddFading (size_t n, double *rxPowerDbm) {
+  m_class.resize (n);
+  m_logGamma.resize (n);
+  m_pending.clear ();
+  for (uint32_t i = 0; i < n; i++) {
+    double d = std::sqrt (m_d2[i]);
+    m_class[i] = d < m_distance1 ? 0 : (d < m_distance2 ? 1 : 2);
+    m_pending.push_back (i);
+  }
+
+  //Marsaglia-Tsang on Gamma (a, 1), a = m or m + 1; rejected lanes retry
+  while (!m_pending.empty ()) {
+    size_t k = m_pending.size ();
+    m_x.resize (k);
+    m_u.resize (k);
+    m_v.resize (k);
+    m_logU.resize (k);
+    m_logV.resize (k);
+    for (size_t j = 0; j < k; j++) {
+      double shape = m_shape[m_class[m_pending[j]]];
+      double a = shape < 1 ? shape + 1 : shape;
+      double c = 1.0 / std::sqrt (9 * (a - 1.0 / 3));
+      double t = 1 + c * m_normal->GetValue (0, 1);
+      m_x[j] = (t - 1) / c;
+      m_v[j] = t > 0 ? t * t * t : 1.0;
+      m_u[j] = m_uniform->GetValue (0, 1);
+      if (t <= 0) {
+        m_u[j] = 1.0; //forces a reject below
+        m_x[j] = 0;
+      }
+    }
+    simd::Log10 (&m_u[0], &m_logU[0], k);
+    simd::Log10 (&m_v[0], &m_logV[0], k);
+    m_rejected.clear ();
+    for (size_t j = 0; j < k; j++) {
+      uint32_t i = m_pending[j];
+      double shape = m_shape[m_class[i]];
+      double d = (shape < 1 ? shape + 1 : shape) - 1.0 / 3;
+      double lnU = m_logU[j] / simd::kInvLn10;
+      double lnV = m_logV[j] / simd::kInvLn10;
+      if (m_u[j] < 1.0 && lnU < 0.5 * m_x[j] * m_x[j] + d - d * m_v[j] + d * lnV) {
+        m_logGamma[i] = m_log10D[m_class[i]] + m_logV[j];
+      } else {
+        m_rejected.push_back (i);
+      }
+    }
+    m_pending.swap (m_rejected);
+  }
+
+  //Gamma (m) = Gamma (m + 1) * U^(1/m) for m < 1
+  m_pending.clear ();
+  for (uint32_t i = 0; i < n; i++) {
+    if (m_shape[m_class[i]] < 1) {
+      m_pending.push_back (i);
+    }
+  }
+  if (!m_pending.empty ()) {
+    size_t k = m_pending.size ();
+    m_u.resize (k);
+    m_logU.resize (k);
+    for (size_t j = 0; j < k; j++) {
+      m_u[j] = m_uniform->GetValue (0, 1);
+    }
+    simd::Log10 (&m_u[0], &m_logU[0], k);
+    for (size_t j = 0; j < k; j++) {
+      uint32_t i = m_pending[j];
+      m_logGamma[i] += m_logU[j] / m_shape[m_class[i]];
+    }
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    rxPowerDbm[i] += 10 * (m_logGamma[i] - m_log10Shape[m_class[i]]);
+  }
+}
+
+} // namespace ns3
+
+#endif /* BATCH_LOSS_H */
@@ -0,0 +1,63 @@
+#!/bin/bash
+# Measures what Packet::EnablePrinting costs: runs manet with and without
+# --metadata and compares the packets/s of the "Run stats" lines.
+# Run from the ns-3 top directory (same place as sweep.sh).
+#
+# ./bench-metadata.sh [-r reps] [-t time] [-B] [-- extra manet arguments]
+#
+# Prints one CSV row per run and protocol, then the mean packets/s of each
+# mode and the off/on ratio.
+
+REPS=3
+TIME=55
+BUILD=1
+
+while getopts "r:t:B" opt; do
+  case $opt in
+    r) REPS=$OPTARG ;;
+    t) TIME=$OPTARG ;;
+    B) BUILD=0 ;;
+    *) echo "usage: $0 [-r reps] [-t time] [-B] [-- extra manet arguments]" >&2
+       exit 1 ;;
+  esac
+done
+shift $((OPTIND-1))
+
+if [ $BUILD -eq 1 ]; then
+  ./waf build || exit 1
+fi
+
+#same lookup as sweep.sh
+find_binary () {
+  local b
+  for b in build/scratch/$1 build/scratch/ns3*-$1-*; do
+    if [ -x "$b" ] && [ -f "$b" ]; then
+      echo "$PWD/$b"
+      return 0
+    fi
+  done
+  return 1
+}
+
+bin=$(find_binary manet) || { echo "no binary for manet, build it first" >&2; exit 1; }
+export LD_LIBRARY_PATH="$PWD/build/lib${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}"
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+echo "Metadata,Rep,PhyTx,SimSeconds,WallSeconds,PacketsPerSecond"
+for rep in $(seq 1 $REPS); do
+  for metadata in 0 1; do
+    #serial runs, so the wall clocks do not compete for cores
+    (cd "$dir" && "$bin" --parallel=0 --metadata=$metadata --time=$TIME "$@" \
+        --CSVfileName=throughput.csv > stdout.txt 2> stderr.txt) || { echo "manet failed, see $dir/stderr.txt" >&2; trap - EXIT; exit 1; }
+    #Run stats: N phy tx, S s simulated in W s wall, X packets/s
+    awk -v m=$metadata -v r=$rep '/^Run stats:/ { print m "," r "," $3 "," $6 "," $10 "," $13 }' "$dir/stdout.txt"
+  done
+done | tee "$dir/bench.csv"
+
+awk -F, 'NR > 1 { sum[$1] += $6; n[$1]++ }
+  END {
+    off = n[0] ? sum[0] / n[0] : 0; on = n[1] ? sum[1] / n[1] : 0
+    printf "metadata off: %.0f packets/s\nmetadata on:  %.0f packets/s\n", off, on
+    if (on > 0) printf "off/on: %.2fx\n", off / on
+  }' "$dir/bench.csv"
@@ -0,0 +1,90 @@
+#!/bin/bash
+# Benchmarks the simulator itself: runs every scenario with fixed seeds at
+# several sizes and protocols and collects the "Bench," line each run
+# prints (see run-stats.h) into one CSV, so runs can be compared against a
+# baseline. Run from the ns-3 top directory (same place as sweep.sh).
+#
+# ./bench.sh [-s scenarios] [-n nodesPerBuilding] [-P protocols] [-r seeds]
+#            [-t time] [-o csv] [-B]
+#
+# Lists are space separated. -n and -P only apply to the manet scenarios;
+# Friis-model and Nakagami-model (lab1) are two fixed nodes and run once
+# per seed. Runs are serial so they do not compete for cores or memory.
+
+SCENARIOS="manet corner-manet center-manet Friis-model Nakagami-model"
+NODES="5 10 20"
+PROTOCOLS="1 2 3"
+SEEDS="1"
+TIME=55
+CSV="bench.csv"
+BUILD=1
+
+while getopts "s:n:P:r:t:o:B" opt; do
+  case $opt in
+    s) SCENARIOS=$OPTARG ;;
+    n) NODES=$OPTARG ;;
+    P) PROTOCOLS=$OPTARG ;;
+    r) SEEDS=$OPTARG ;;
+    t) TIME=$OPTARG ;;
+    o) CSV=$OPTARG ;;
+    B) BUILD=0 ;;
+    *) echo "usage: $0 [-s scenarios] [-n nodesPerBuilding] [-P protocols] [-r seeds] [-t time] [-o csv] [-B]" >&2
+       exit 1 ;;
+  esac
+done
+
+if [ $BUILD -eq 1 ]; then
+  ./waf build || exit 1
+fi
+
+#same lookup as sweep.sh, plus directory programs (build/scratch/lab1/lab1)
+find_binary () {
+  local b
+  for b in build/scratch/$1 build/scratch/ns3*-$1-* build/scratch/$1/$1 build/scratch/$1/ns3*-$1-*; do
+    if [ -x "$b" ] && [ -f "$b" ]; then
+      echo "$PWD/$b"
+      return 0
+    fi
+  done
+  return 1
+}
+
+export LD_LIBRARY_PATH="$PWD/build/lib${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}"
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+#one benchmark run; prefixes its Bench lines with what was run
+bench_one () {
+  local s=$1 bin=$2 nodes=$3 p=$4 r=$5
+  shift 5
+  (cd "$dir" && "$bin" --RngRun=$r "$@" > stdout.txt 2> stderr.txt)
+  if [ $? -ne 0 ]; then
+    echo "$s nodes=$nodes protocol=$p seed=$r failed" >&2
+    return
+  fi
+  grep '^Bench,' "$dir/stdout.txt" | sed "s/^Bench,/$s,$nodes,$p,$r,/" >> "$CSV"
+  echo "done $s nodes=$nodes protocol=$p seed=$r" >&2
+}
+
+echo "Scenario,NodesPerBuilding,Protocol,Seed,WallSeconds,SimSeconds,PhyTx,Events,EventsPerSecond,SimPerWall,PeakRssKb,Allocations,Delivered,AllocsPerPacket" > "$CSV"
+for s in $SCENARIOS; do
+  prog=$s
+  if [ "$s" = "Nakagami-model" ]; then
+    prog=lab1
+  fi
+  bin=$(find_binary "$prog") || { echo "no binary for $s, build it first" >&2; exit 1; }
+  for r in $SEEDS; do
+    case $s in
+      *manet)
+        for n in $NODES; do
+          for p in $PROTOCOLS; do
+            bench_one $s "$bin" $n $p $r --parallel=0 --protocol=$p \
+              --nodesPerBuilding=$n --time=$TIME --CSVfileName=throughput.csv
+          done
+        done ;;
+      *)
+        bench_one $s "$bin" 2 0 $r ;;
+    esac
+  done
+done
+echo "wrote $CSV" >&2
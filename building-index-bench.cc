@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/buildings-module.h"
+#include "building-index.h"
+
+using namespace ns3;
+using namespace std;
+
+NS_LOG_COMPONENT_DEFINE ("BuildingIndexBench");
+
+//Linear scans over BuildingList vs. BuildingIndex as the city grows.
+//Buildings are size x size boxes in rows of 100, separated by streets.
+
+static double Ns (chrono::steady_clock::time_point start, uint32_t n) {
+  chrono::duration<double, nano> ns = chrono::steady_clock::now () - start;
+  return ns.count () / n;
+}
+
+static int32_t ScanFind (const Vector &pos) {
+  int32_t i = 0;
+  for (BuildingList::Iterator it = BuildingList::Begin (); it != BuildingList::End (); ++it, ++i) {
+    if ((*it)->IsInside (pos)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void ScanCrossed (const Vector &a, const Vector &b, vector<uint32_t> &out) {
+  out.clear ();
+  uint32_t i = 0;
+  for (BuildingList::Iterator it = BuildingList::Begin (); it != BuildingList::End (); ++it, ++i) {
+    if (BuildingIndex::Crosses ((*it)->GetBoundaries (), a, b)) {
+      out.push_back (i);
+    }
+  }
+}
+
+int main (int argc, char *argv[]) {
+  uint32_t queries = 100000;
+  uint32_t nodes = 1000;
+  uint32_t maxBuildings = 10000;
+  double size = 40;
+  double street = 20;
+  double link = 200;
+
+  CommandLine cmd;
+  cmd.AddValue ("queries", "point and segment queries per step", queries);
+  cmd.AddValue ("nodes", "nodes made consistent per step", nodes);
+  cmd.AddValue ("maxBuildings", "largest city to time", maxBuildings);
+  cmd.AddValue ("size", "side of a building", size);
+  cmd.AddValue ("street", "street width between buildings", street);
+  cmd.AddValue ("link", "longest segment for the crossing queries", link);
+  cmd.Parse (argc, argv);
+
+  Ptr<UniformRandomVariable> place = CreateObject<UniformRandomVariable> ();
+  NodeContainer all;
+  all.Create (nodes);
+  MobilityHelper mobility;
+  mobility.Install (all);
+  BuildingsHelper::Install (all);
+
+  double pitch = size + street;
+  uint32_t columns = 100;
+  uint32_t count = 0;
+  cout << "buildings,build_us,scan_find_ns,index_find_ns,scan_cross_ns,index_cross_ns,"
+       << "scan_consistent_us,index_consistent_us,mismatches\n";
+  for (uint32_t target = 4; ; target = min (target * 10, maxBuildings)) {
+    //BuildingList only grows, so each step adds to the previous city
+    for (; count < target; count++) {
+      double x = (count % columns) * pitch, y = (count / columns) * pitch;
+      Ptr<Building> building = CreateObject<Building> ();
+      building->SetBoundaries (Box (x, x + size, y, y + size, 0, 10));
+      building->SetExtWallsType (Building::ConcreteWithWindows);
+    }
+    double width = min (count, columns) * pitch;
+    double height = ((count + columns - 1) / columns) * pitch;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+    Ptr<BuildingIndex> index = Create<BuildingIndex> ();
+    index->Build ();
+    double build = Ns (start, 1000);
+
+    vector<Vector> points, ends;
+    for (uint32_t q = 0; q < queries; q++) {
+      Vector a (place->GetValue (0, width), place->GetValue (0, height), 1);
+      double angle = place->GetValue (0, 2 * M_PI), length = place->GetValue (0, link);
+      points.push_back (a);
+      ends.push_back (Vector (a.x + length * cos (angle), a.y + length * sin (angle), 1));
+    }
+
+    //Queries whose building or set of crossed buildings differs
+    uint32_t mismatches = 0;
+    vector<int32_t> scanFound (queries), indexFound (queries);
+    start = chrono::steady_clock::now ();
+    for (uint32_t q = 0; q < queries; q++) {
+      scanFound[q] = ScanFind (points[q]);
+    }
+    double scanFind = Ns (start, queries);
+    start = chrono::steady_clock::now ();
+    for (uint32_t q = 0; q < queries; q++) {
+      indexFound[q] = index->Find (points[q]);
+    }
+    double indexFind = Ns (start, queries);
+    for (uint32_t q = 0; q < queries; q++) {
+      mismatches += scanFound[q] != indexFound[q];
+    }
+
+    vector<uint32_t> scanCrossed, crossed;
+    start = chrono::steady_clock::now ();
+    for (uint32_t q = 0; q < queries; q++) {
+      ScanCrossed (points[q], ends[q], scanCrossed);
+    }
+    double scanCross = Ns (start, queries);
+    start = chrono::steady_clock::now ();
+    for (uint32_t q = 0; q < queries; q++) {
+      index->Crossed (points[q], ends[q], crossed);
+    }
+    double indexCross = Ns (start, queries);
+    //Untimed: the scan lists buildings in order, the index in walk order
+    for (uint32_t q = 0; q < queries; q++) {
+      ScanCrossed (points[q], ends[q], scanCrossed);
+      index->Crossed (points[q], ends[q], crossed);
+      sort (crossed.begin (), crossed.end ());
+      mismatches += scanCrossed != crossed;
+    }
+
+    for (uint32_t i = 0; i < nodes; i++) {
+      all.Get (i)->GetObject<MobilityModel> ()->SetPosition (points[i % queries]);
+    }
+    start = chrono::steady_clock::now ();
+    BuildingsHelper::MakeMobilityModelConsistent ();
+    double scanConsistent = Ns (start, 1000);
+    start = chrono::steady_clock::now ();
+    index->MakeConsistent ();
+    double indexConsistent = Ns (start, 1000);
+
+    cout << count << "," << build << "," << scanFind << "," << indexFind << ","
+         << scanCross << "," << indexCross << "," << scanConsistent << ","
+         << indexConsistent << "," << mismatches << "\n";
+    if (target == maxBuildings) {
+      break;
+    }
+  }
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,232 @@
+#ifndef BUILDING_INDEX_H
+#define BUILDING_INDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/network-module.h"
+#include "ns3/buildings-module.h"
+
+namespace ns3 {
+
+//Uniform grid over the building footprints in BuildingList. Every building
+//is registered in each cell its box overlaps, so a point lookup only tests
+//the few buildings of one cell and a segment query walks the cells along
+//the segment. Build () once after all buildings exist; buildings added
+//later are not seen until the next Build ().
+class BuildingIndex : public SimpleRefCount<BuildingIndex>
+{
+public:
+  BuildingIndex () : m_cell (1), m_nx (0), m_ny (0), m_x0 (0), m_y0 (0), m_stamp (0) {}
+
+  void Build ();
+  uint32_t GetN () const { return m_buildings.size (); }
+  Ptr<Building> Get (uint32_t i) const { return m_buildings[i]; }
+  const Box &GetBox (uint32_t i) const { return m_boxes[i]; }
+
+  //Index of the building containing pos, or -1 when outdoors
+  int32_t Find (const Vector &pos) const;
+  //Buildings whose footprint the segment a-b passes through
+  void Crossed (const Vector &a, const Vector &b, std::vector<uint32_t> &out) const;
+  //BuildingsHelper::MakeMobilityModelConsistent () using the index
+  void MakeConsistent () const;
+
+  //2D slab test of segment a-b against the footprint of box
+  static bool Crosses (const Box &box, const Vector &a, const Vector &b);
+
+private:
+  int64_t CellX (double x) const { return std::min<int64_t> (std::max<int64_t> ((int64_t)std::floor ((x - m_x0) / m_cell), 0), m_nx - 1); }
+  int64_t CellY (double y) const { return std::min<int64_t> (std::max<int64_t> ((int64_t)std::floor ((y - m_y0) / m_cell), 0), m_ny - 1); }
+  void Visit (int64_t cx, int64_t cy, const Vector &a, const Vector &b, std::vector<uint32_t> &out) const;
+
+  std::vector<Ptr<Building> > m_buildings;
+  std::vector<Box> m_boxes;
+  std::vector<std::vector<uint32_t> > m_cells;
+  double m_cell;
+  int64_t m_nx;
+  int64_t m_ny;
+  double m_x0;
+  double m_y0;
+  mutable uint32_t m_stamp;
+  mutable std::vector<uint32_t> m_seen;
+};
+
+inline void BuildingIndex::Build () {
+  m_buildings.clear ();
+  m_boxes.clear ();
+  m_cells.clear ();
+  double xMin = 0, xMax = 0, yMin = 0, yMax = 0, area = 0;
+  for (BuildingList::Iterator it = BuildingList::Begin (); it != BuildingList::End (); ++it) {
+    Box box = (*it)->GetBoundaries ();
+    if (m_boxes.empty ()) {
+      xMin = box.xMin;
+      xMax = box.xMax;
+      yMin = box.yMin;
+      yMax = box.yMax;
+    }
+    xMin = std::min (xMin, box.xMin);
+    xMax = std::max (xMax, box.xMax);
+    yMin = std::min (yMin, box.yMin);
+    yMax = std::max (yMax, box.yMax);
+    area += (box.xMax - box.xMin) * (box.yMax - box.yMin);
+    m_buildings.push_back (*it);
+    m_boxes.push_back (box);
+  }
+  m_seen.assign (m_boxes.size (), 0);
+  m_stamp = 0;
+  if (m_boxes.empty ()) {
+    m_nx = m_ny = 0;
+    return;
+  }
+  //About one building footprint per cell
+  m_cell = std::max (std::sqrt (area / m_boxes.size ()), 1.0);
+  m_x0 = xMin;
+  m_y0 = yMin;
+  m_nx = (int64_t)std::floor ((xMax - xMin) / m_cell) + 1;
+  m_ny = (int64_t)std::floor ((yMax - yMin) / m_cell) + 1;
+  m_cells.resize (m_nx * m_ny);
+  for (uint32_t i = 0; i < m_boxes.size (); i++) {
+    for (int64_t cx = CellX (m_boxes[i].xMin); cx <= CellX (m_boxes[i].xMax); cx++) {
+      for (int64_t cy = CellY (m_boxes[i].yMin); cy <= CellY (m_boxes[i].yMax); cy++) {
+        m_cells[cx * m_ny + cy].push_back (i);
+      }
+    }
+  }
+}
+
+inline int32_t BuildingIndex::Find (const Vector &pos) const {
+  if (m_cells.empty () || pos.x < m_x0 || pos.y < m_y0) {
+    return -1;
+  }
+  int64_t cx = (int64_t)std::floor ((pos.x - m_x0) / m_cell);
+  int64_t cy = (int64_t)std::floor ((pos.y - m_y0) / m_cell);
+  if (cx >= m_nx || cy >= m_ny) {
+    return -1;
+  }
+  const std::vector<uint32_t> &cell = m_cells[cx * m_ny + cy];
+  for (uint32_t k = 0; k < cell.size (); k++) {
+    if (m_boxes[cell[k]].IsInside (pos)) {
+      return cell[k];
+    }
+  }
+  return -1;
+}
+
+inline bool BuildingIndex::Crosses (const Box &box, const Vector &a, const Vector &b) {
+  double t0 = 0, t1 = 1;
+  double d[2] = {b.x - a.x, b.y - a.y};
+  double p[2] = {a.x, a.y};
+  double lo[2] = {box.xMin, box.yMin};
+  double hi[2] = {box.xMax, box.yMax};
+  for (int k = 0; k < 2; k++) {
+    if (d[k] == 0) {
+      if (p[k] <= lo[k] || p[k] >= hi[k]) {
+        return false;
+      }
+      continue;
+    }
+    double ta = (lo[k] - p[k]) / d[k];
+    double tb = (hi[k] - p[k]) / d[k];
+    t0 = std::max (t0, std::min (ta, tb));
+    t1 = std::min (t1, std::max (ta, tb));
+  }
+  return t0 < t1;
+}
+
+inline void BuildingIndex::Visit (int64_t cx, int64_t cy, const Vector &a, const Vector &b, std::vector<uint32_t> &out) const {
+  const std::vector<uint32_t> &cell = m_cells[cx * m_ny + cy];
+  for (uint32_t k = 0; k < cell.size (); k++) {
+    uint32_t i = cell[k];
+    if (m_seen[i] != m_stamp) {
+      m_seen[i] = m_stamp;
+      if (Crosses (m_boxes[i], a, b)) {
+        out.push_back (i);
+      }
+    }
+  }
+}
+
+//Walks the grid cells the segment passes through (Amanatides-Woo)
+inline void BuildingIndex::Crossed (const Vector &a, const Vector &b, std::vector<uint32_t> &out) const {
+  out.clear ();
+  if (m_cells.empty ()) {
+    return;
+  }
+  if (++m_stamp == 0) {
+    std::fill (m_seen.begin (), m_seen.end (), 0);
+    m_stamp = 1;
+  }
+  //Clip to the indexed area so the walk starts and ends inside the grid
+  double t0 = 0, t1 = 1;
+  double d[2] = {b.x - a.x, b.y - a.y};
+  double p[2] = {a.x, a.y};
+  double lo[2] = {m_x0, m_y0};
+  double hi[2] = {m_x0 + m_nx * m_cell, m_y0 + m_ny * m_cell};
+  for (int k = 0; k < 2; k++) {
+    if (d[k] == 0) {
+      if (p[k] < lo[k] || p[k] > hi[k]) {
+        return;
+      }
+      continue;
+    }
+    double ta = (lo[k] - p[k]) / d[k];
+    double tb = (hi[k] - p[k]) / d[k];
+    t0 = std::max (t0, std::min (ta, tb));
+    t1 = std::min (t1, std::max (ta, tb));
+  }
+  if (t0 > t1) {
+    return;
+  }
+  double sx = p[0] + t0 * d[0], sy = p[1] + t0 * d[1];
+  double ex = p[0] + t1 * d[0], ey = p[1] + t1 * d[1];
+  int64_t cx = CellX (sx), cy = CellY (sy);
+  int64_t lastX = CellX (ex), lastY = CellY (ey);
+  int64_t stepX = d[0] > 0 ? 1 : -1, stepY = d[1] > 0 ? 1 : -1;
+  double inf = std::numeric_limits<double>::infinity ();
+  double deltaX = d[0] != 0 ? m_cell / std::fabs (d[0]) : inf;
+  double deltaY = d[1] != 0 ? m_cell / std::fabs (d[1]) : inf;
+  double nextX = d[0] != 0 ? (m_x0 + (cx + (stepX > 0)) * m_cell - p[0]) / d[0] : inf;
+  double nextY = d[1] != 0 ? (m_y0 + (cy + (stepY > 0)) * m_cell - p[1]) / d[1] : inf;
+  Visit (cx, cy, a, b, out);
+  while (cx != lastX || cy != lastY) {
+    if (nextX < nextY) {
+      cx += stepX;
+      nextX += deltaX;
+    } else {
+      cy += stepY;
+      nextY += deltaY;
+    }
+    if (cx < 0 || cx >= m_nx || cy < 0 || cy >= m_ny) {
+      break;
+    }
+    Visit (cx, cy, a, b, out);
+  }
+}
+
+inline void BuildingIndex::MakeConsistent () const {
+  for (NodeList::Iterator nit = NodeList::Begin (); nit != NodeList::End (); ++nit) {
+    Ptr<MobilityModel> mm = (*nit)->GetObject<MobilityModel> ();
+    if (mm == 0) {
+      continue;
+    }
+    Ptr<MobilityBuildingInfo> info = mm->GetObject<MobilityBuildingInfo> ();
+    if (info == 0) {
+      continue;
+    }
+    Vector pos = mm->GetPosition ();
+    int32_t i = Find (pos);
+    if (i < 0) {
+      info->SetOutdoor ();
+    } else {
+      Ptr<Building> building = m_buildings[i];
+      info->SetIndoor (building, building->GetFloor (pos), building->GetRoomX (pos), building->GetRoomY (pos));
+    }
+  }
+}
+
+} // namespace ns3
+
+#endif /* BUILDING_INDEX_H */
@@ -0,0 +1,196 @@
+#ifndef BUILDING_WALL_LOSS_MODEL_H
+#define BUILDING_WALL_LOSS_MODEL_H
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/buildings-module.h"
+#include "building-index.h"
+
+namespace ns3 {
+
+//Adds external wall penetration loss between the buildings of the scenario
+//and leaves the distance loss to the next model in the chain (e.g. Friis).
+//A link pays the wall loss of each endpoint that is inside a building other
+//than the other endpoint's, plus two walls of every other building the
+//straight line between them crosses. Each node's building is looked up when
+//it is first seen and again on every course change; the per-pair loss is
+//cached and only recomputed once an endpoint has moved into a different
+//building (or outdoors). Wall crossings of a pair are taken from the
+//positions at the time the pair is classified. Building lookups go through
+//a BuildingIndex, either the scenario's or one built on first use.
+class BuildingWallLossModel : public PropagationLossModel
+{
+public:
+  static TypeId GetTypeId (void);
+  BuildingWallLossModel ();
+
+  //Loss of one external wall of the given type, as in BuildingsPropagationLossModel
+  static double ExternalWallLoss (Building::ExtWallsType_t type);
+
+  //Shares an index the scenario already built; must cover the same buildings
+  void SetBuildingIndex (Ptr<BuildingIndex> index) { m_index = index; }
+  uint64_t GetHits (void) const { return m_hits; }
+  uint64_t GetMisses (void) const { return m_misses; }
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  struct Endpoint {
+    Ptr<MobilityModel> mobility;
+    int32_t building;
+    uint32_t epoch;
+  };
+  struct Link {
+    uint32_t epochA;
+    uint32_t epochB;
+    double lossDb;
+  };
+  typedef std::pair<const MobilityModel *, const MobilityModel *> Key;
+  struct KeyHash {
+    size_t operator() (const Key &key) const {
+      size_t a = std::hash<const MobilityModel *> () (key.first);
+      return a ^ (std::hash<const MobilityModel *> () (key.second) + 0x9e3779b97f4a7c15ULL + (a << 6) + (a >> 2));
+    }
+  };
+
+  virtual double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const;
+  virtual int64_t DoAssignStreams (int64_t stream) { return 0; }
+  Endpoint &Track (Ptr<MobilityModel> mobility);
+  void CourseChanged (Ptr<const MobilityModel> mobility);
+  void LoadBuildings ();
+  int32_t FindBuilding (const Vector &pos) const { return m_index->Find (pos); }
+  double WallLoss (int32_t ba, const Vector &pa, int32_t bb, const Vector &pb);
+
+  Ptr<BuildingIndex> m_index;
+  std::vector<double> m_wallLoss;
+  std::vector<uint32_t> m_crossed;
+  std::unordered_map<const MobilityModel *, Endpoint> m_endpoints;
+  std::unordered_map<Key, Link, KeyHash> m_links;
+  uint64_t m_hits;
+  uint64_t m_misses;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (BuildingWallLossModel);
+
+inline TypeId BuildingWallLossModel::GetTypeId (void) {
+  static TypeId tid = TypeId ("ns3::BuildingWallLossModel")
+    .SetParent<PropagationLossModel> ()
+    .SetGroupName ("Buildings")
+    .AddConstructor<BuildingWallLossModel> ();
+  return tid;
+}
+
+inline BuildingWallLossModel::BuildingWallLossModel ()
+  : m_hits (0),
+    m_misses (0)
+{
+}
+
+inline void BuildingWallLossModel::DoDispose (void) {
+  m_endpoints.clear ();
+  m_links.clear ();
+  m_index = 0;
+  PropagationLossModel::DoDispose ();
+}
+
+inline double BuildingWallLossModel::ExternalWallLoss (Building::ExtWallsType_t type) {
+  switch (type) {
+    case Building::Wood:
+      return 4;
+    case Building::ConcreteWithWindows:
+      return 7;
+    case Building::ConcreteWithoutWindows:
+      return 15;
+    case Building::StoneBlocks:
+      return 12;
+  }
+  return 0;
+}
+
+//Buildings are read on first use, after the scenario has created them
+inline void BuildingWallLossModel::LoadBuildings () {
+  if (m_index == 0) {
+    m_index = Create<BuildingIndex> ();
+    m_index->Build ();
+  }
+  m_wallLoss.clear ();
+  for (uint32_t i = 0; i < m_index->GetN (); i++) {
+    m_wallLoss.push_back (ExternalWallLoss (m_index->Get (i)->GetExtWallsType ()));
+  }
+}
+
+inline double BuildingWallLossModel::WallLoss (int32_t ba, const Vector &pa, int32_t bb, const Vector &pb) {
+  if (ba == bb) {
+    return 0;
+  }
+  double loss = 0;
+  if (ba >= 0) {
+    loss += m_wallLoss[ba];
+  }
+  if (bb >= 0) {
+    loss += m_wallLoss[bb];
+  }
+  m_index->Crossed (pa, pb, m_crossed);
+  for (uint32_t k = 0; k < m_crossed.size (); k++) {
+    int32_t i = m_crossed[k];
+    if (i != ba && i != bb) {
+      loss += 2 * m_wallLoss[i];
+    }
+  }
+  return loss;
+}
+
+inline BuildingWallLossModel::Endpoint &BuildingWallLossModel::Track (Ptr<MobilityModel> mobility) {
+  std::unordered_map<const MobilityModel *, Endpoint>::iterator it = m_endpoints.find (PeekPointer (mobility));
+  if (it != m_endpoints.end ()) {
+    return it->second;
+  }
+  if (m_endpoints.empty ()) {
+    LoadBuildings ();
+  }
+  Endpoint &endpoint = m_endpoints[PeekPointer (mobility)];
+  endpoint.mobility = mobility;
+  endpoint.building = FindBuilding (mobility->GetPosition ());
+  endpoint.epoch = 0;
+  mobility->TraceConnectWithoutContext ("CourseChange",
+                                        MakeCallback (&BuildingWallLossModel::CourseChanged, this));
+  return endpoint;
+}
+
+//Only a change of building invalidates the node's links
+inline void BuildingWallLossModel::CourseChanged (Ptr<const MobilityModel> mobility) {
+  Endpoint &endpoint = m_endpoints[PeekPointer (mobility)];
+  int32_t building = FindBuilding (mobility->GetPosition ());
+  if (building != endpoint.building) {
+    endpoint.building = building;
+    endpoint.epoch++;
+  }
+}
+
+inline double BuildingWallLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const {
+  //DoCalcRxPower is const in ns-3, the cache is bookkeeping
+  BuildingWallLossModel *self = const_cast<BuildingWallLossModel *> (this);
+  const Endpoint &ea = self->Track (a);
+  const Endpoint &eb = self->Track (b);
+  Link &link = self->m_links[Key (PeekPointer (a), PeekPointer (b))];
+  //epochs are stored +1 so a new, zeroed entry never matches
+  if (link.epochA != ea.epoch + 1 || link.epochB != eb.epoch + 1) {
+    link.lossDb = self->WallLoss (ea.building, a->GetPosition (), eb.building, b->GetPosition ());
+    link.epochA = ea.epoch + 1;
+    link.epochB = eb.epoch + 1;
+    self->m_misses++;
+  } else {
+    self->m_hits++;
+  }
+  return txPowerDbm - link.lossDb;
+}
+
+} // namespace ns3
+
+#endif /* BUILDING_WALL_LOSS_MODEL_H */
@@ -0,0 +1,135 @@
+#ifndef CACHED_LOSS_MODEL_H
+#define CACHED_LOSS_MODEL_H
+
+#include <unordered_map>
+#include <utility>
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-loss-model.h"
+
+namespace ns3 {
+
+//Caches the loss of a deterministic propagation loss model (e.g. Friis) per
+//(tx mobility, rx mobility) pair. Only pairs where both ends are standing
+//still are cached; an entry is dropped as soon as either end reports a
+//course change. The cached model must give a loss that does not depend on
+//the transmit power. Anything chained after this model with SetNext, such
+//as Nakagami fading, is still evaluated on every call.
+class CachedPropagationLossModel : public PropagationLossModel
+{
+public:
+  static TypeId GetTypeId (void);
+  CachedPropagationLossModel ();
+
+  void SetCachedModel (Ptr<PropagationLossModel> model) { m_model = model; m_links.clear (); }
+  Ptr<PropagationLossModel> GetCachedModel (void) const { return m_model; }
+  uint64_t GetHits (void) const { return m_hits; }
+  uint64_t GetMisses (void) const { return m_misses; }
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  struct Endpoint {
+    Ptr<MobilityModel> mobility;
+    uint32_t epoch;
+    bool fixed;
+  };
+  struct Link {
+    uint32_t epochA;
+    uint32_t epochB;
+    double lossDb;
+  };
+  typedef std::pair<const MobilityModel *, const MobilityModel *> Key;
+  struct KeyHash {
+    size_t operator() (const Key &key) const {
+      size_t a = std::hash<const MobilityModel *> () (key.first);
+      return a ^ (std::hash<const MobilityModel *> () (key.second) + 0x9e3779b97f4a7c15ULL + (a << 6) + (a >> 2));
+    }
+  };
+
+  virtual double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const;
+  virtual int64_t DoAssignStreams (int64_t stream);
+  Endpoint &Track (Ptr<MobilityModel> mobility);
+  void CourseChanged (Ptr<const MobilityModel> mobility);
+
+  Ptr<PropagationLossModel> m_model;
+  std::unordered_map<const MobilityModel *, Endpoint> m_endpoints;
+  std::unordered_map<Key, Link, KeyHash> m_links;
+  uint64_t m_hits;
+  uint64_t m_misses;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (CachedPropagationLossModel);
+
+inline TypeId CachedPropagationLossModel::GetTypeId (void) {
+  static TypeId tid = TypeId ("ns3::CachedPropagationLossModel")
+    .SetParent<PropagationLossModel> ()
+    .SetGroupName ("Propagation")
+    .AddConstructor<CachedPropagationLossModel> ();
+  return tid;
+}
+
+inline CachedPropagationLossModel::CachedPropagationLossModel ()
+  : m_hits (0),
+    m_misses (0)
+{
+}
+
+inline void CachedPropagationLossModel::DoDispose (void) {
+  m_endpoints.clear ();
+  m_links.clear ();
+  m_model = 0;
+  PropagationLossModel::DoDispose ();
+}
+
+inline int64_t CachedPropagationLossModel::DoAssignStreams (int64_t stream) {
+  return m_model ? m_model->AssignStreams (stream) : 0;
+}
+
+//First sight of a mobility model hooks its course changes
+inline CachedPropagationLossModel::Endpoint &CachedPropagationLossModel::Track (Ptr<MobilityModel> mobility) {
+  std::unordered_map<const MobilityModel *, Endpoint>::iterator it = m_endpoints.find (PeekPointer (mobility));
+  if (it != m_endpoints.end ()) {
+    return it->second;
+  }
+  Endpoint &endpoint = m_endpoints[PeekPointer (mobility)];
+  endpoint.mobility = mobility;
+  endpoint.epoch = 0;
+  endpoint.fixed = CalculateDistance (mobility->GetVelocity (), Vector ()) == 0;
+  mobility->TraceConnectWithoutContext ("CourseChange",
+                                        MakeCallback (&CachedPropagationLossModel::CourseChanged, this));
+  return endpoint;
+}
+
+inline void CachedPropagationLossModel::CourseChanged (Ptr<const MobilityModel> mobility) {
+  Endpoint &endpoint = m_endpoints[PeekPointer (mobility)];
+  endpoint.epoch++;
+  endpoint.fixed = CalculateDistance (mobility->GetVelocity (), Vector ()) == 0;
+}
+
+inline double CachedPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const {
+  //DoCalcRxPower is const in ns-3, the cache is bookkeeping
+  CachedPropagationLossModel *self = const_cast<CachedPropagationLossModel *> (this);
+  const Endpoint &ea = self->Track (a);
+  const Endpoint &eb = self->Track (b);
+  if (!ea.fixed || !eb.fixed) {
+    self->m_misses++;
+    return m_model->CalcRxPower (txPowerDbm, a, b);
+  }
+  Link &link = self->m_links[Key (PeekPointer (a), PeekPointer (b))];
+  if (link.epochA != ea.epoch + 1 || link.epochB != eb.epoch + 1) {
+    //epochs are stored +1 so a new, zeroed entry never matches
+    link.lossDb = -m_model->CalcRxPower (0, a, b);
+    link.epochA = ea.epoch + 1;
+    link.epochB = eb.epoch + 1;
+    self->m_misses++;
+  } else {
+    self->m_hits++;
+  }
+  return txPowerDbm - link.lossDb;
+}
+
+} // namespace ns3
+
+#endif /* CACHED_LOSS_MODEL_H */
@@ -0,0 +1,306 @@
+#ifndef CAMPUS_SCENARIO_H
+#define CAMPUS_SCENARIO_H
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/buildings-module.h"
+#include "scenario-file.h"
+
+namespace ns3 {
+
+//Layout of the generated campus. The defaults are the original lab layout:
+//2 x 2 buildings of 100 x 50 m with 25 m streets and 10 nodes in each.
+struct CampusParams
+{
+  CampusParams ()
+    : buildings (4),
+      columns (2),
+      nodesPerBuilding (10),
+      width (100),
+      depth (50),
+      street (25),
+      stories (10),
+      nSep (2),
+      walkSpeed (1),
+      staticCorners (false),
+      baseStation (false)
+  {
+  }
+
+  //Registers the layout options on cmd; nSep stays with the scenario
+  void AddValues (CommandLine &cmd) {
+    cmd.AddValue ("buildings", "number of buildings", buildings);
+    cmd.AddValue ("columns", "buildings per row of the campus grid", columns);
+    cmd.AddValue ("nodesPerBuilding", "nodes in each building", nodesPerBuilding);
+    cmd.AddValue ("buildingWidth", "building size along x (m)", width);
+    cmd.AddValue ("buildingDepth", "building size along y (m)", depth);
+    cmd.AddValue ("street", "street width between buildings (m)", street);
+    cmd.AddValue ("scenarioFile", "SCN1 layout written by scenario-write, replaces the generated campus", scenarioFile);
+  }
+
+  uint32_t buildings;
+  uint32_t columns;
+  uint32_t nodesPerBuilding;
+  double width;
+  double depth;
+  double street;
+  double stories;
+  double nSep;
+  double walkSpeed;
+  //The first node of every building stays on its corner as a relay
+  bool staticCorners;
+  //One extra static node in the street crossing nearest the campus center
+  bool baseStation;
+  //Binary layout (see scenario-file.h); the options above are then ignored
+  std::string scenarioFile;
+};
+
+//Builds the nodes, mobility and Building objects of a campus of
+//params.buildings buildings laid out row by row, params.columns per row,
+//separated by streets. Buildings are numbered in a snake order (left to
+//right, then right to left on the next row) so the default 2 x 2 campus
+//keeps the original b1..b4 numbering.
+//
+//Every building gets a column of nodes starting at its corner nearest the
+//campus center, nSep apart and running into the building, wrapping to a
+//new column nSep further in when the building depth is used up. Nodes then
+//random walk inside their building from those positions. Node ids follow
+//the building order; the base station, if any, is the last node.
+//
+//With params.scenarioFile the buildings and nodes come from the mapped
+//file instead, in one pass over its records.
+class CampusScenario
+{
+public:
+  CampusScenario (const CampusParams &params) : m_params (params) {}
+
+  //Building nodes, i.e. the ones that can be picked as sources and sinks
+  static uint32_t GetNBuildingNodes (const CampusParams &params) {
+    if (!params.scenarioFile.empty ()) {
+      ScenarioFile file;
+      NS_ABORT_MSG_UNLESS (file.Open (params.scenarioFile), "Cannot read scenario file " << params.scenarioFile);
+      return file.GetNBuildingNodes ();
+    }
+    return params.buildings * params.nodesPerBuilding;
+  }
+
+  void Build ();
+
+  //Building of the i-th node of GetNodes (), -1 outside any building
+  int32_t GetNodeBuilding (uint32_t i) const { return m_nodeBuilding[i]; }
+  //ScenarioNode::Role bits of the i-th node (static relay, base station)
+  uint32_t GetNodeRoles (uint32_t i) const { return m_nodeRoles[i]; }
+
+  NodeContainer GetNodes () const { return m_nodes; }
+  NodeContainer GetBuildingNodes (uint32_t b) const { return m_buildingNodes[b]; }
+  Ptr<Building> GetBuilding (uint32_t b) const { return m_buildings[b]; }
+  Ptr<Node> GetBaseStation () const { return m_baseStation; }
+  uint32_t GetNBuildings () const { return m_buildings.size (); }
+  Box GetBounds () const;
+
+  //Fixed streams for the random walks
+  int64_t AssignStreams (int64_t stream) {
+    MobilityHelper mobility;
+    return mobility.AssignStreams (m_nodes, stream);
+  }
+
+private:
+  uint32_t GetRows () const { return (m_params.buildings + m_params.columns - 1) / m_params.columns; }
+  Box GetBox (uint32_t b) const;
+  Vector GetNodePosition (const Box &box, uint32_t i) const;
+  void Load ();
+
+  CampusParams m_params;
+  NodeContainer m_nodes;
+  std::vector<NodeContainer> m_buildingNodes;
+  std::vector<Ptr<Building> > m_buildings;
+  Ptr<Node> m_baseStation;
+  std::vector<int32_t> m_nodeBuilding;
+  std::vector<uint32_t> m_nodeRoles;
+  Box m_bounds;
+};
+
+inline Box CampusScenario::GetBox (uint32_t b) const {
+  uint32_t row = b / m_params.columns;
+  uint32_t col = b % m_params.columns;
+  if (row % 2 == 1) {
+    col = m_params.columns - 1 - col;
+  }
+  double x = col * (m_params.width + m_params.street);
+  double y = row * (m_params.depth + m_params.street);
+  return Box (x, x + m_params.width, y, y + m_params.depth, 0, m_params.stories);
+}
+
+inline Box CampusScenario::GetBounds () const {
+  if (!m_params.scenarioFile.empty ()) {
+    return m_bounds;
+  }
+  uint32_t columns = std::min (m_params.buildings, m_params.columns);
+  return Box (0, columns * (m_params.width + m_params.street) - m_params.street,
+              0, GetRows () * (m_params.depth + m_params.street) - m_params.street,
+              0, m_params.stories);
+}
+
+inline Vector CampusScenario::GetNodePosition (const Box &box, uint32_t i) const {
+  Box bounds = GetBounds ();
+  double cx = (bounds.xMin + bounds.xMax) / 2, cy = (bounds.yMin + bounds.yMax) / 2;
+  //Corner facing the center, stepping away from it
+  bool left = std::fabs (box.xMin - cx) < std::fabs (box.xMax - cx);
+  bool bottom = std::fabs (box.yMin - cy) < std::fabs (box.yMax - cy);
+  double x0 = left ? box.xMin : box.xMax, dx = left ? m_params.nSep : -m_params.nSep;
+  double y0 = bottom ? box.yMin : box.yMax, dy = bottom ? m_params.nSep : -m_params.nSep;
+  uint32_t perColumn = m_params.nSep > 0 ? (uint32_t)std::floor (m_params.depth / m_params.nSep) + 1 : 1;
+  double x = std::min (std::max (x0 + (i / perColumn) * dx, box.xMin), box.xMax);
+  return Vector (x, y0 + (i % perColumn) * dy, 0);
+}
+
+inline void CampusScenario::Build () {
+  if (!m_params.scenarioFile.empty ()) {
+    Load ();
+    return;
+  }
+  NS_ABORT_MSG_IF (m_params.columns == 0 || m_params.buildings == 0, "Campus needs at least one building and column");
+  m_nodes = NodeContainer ();
+  m_buildingNodes.assign (m_params.buildings, NodeContainer ());
+  m_buildings.clear ();
+  m_nodeBuilding.clear ();
+  m_nodeRoles.clear ();
+
+  MobilityHelper fixed;
+  fixed.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  for (uint32_t b = 0; b < m_params.buildings; b++) {
+    Box box = GetBox (b);
+    Ptr<Building> building = CreateObject<Building> ();
+    building->SetBoundaries (box);
+    building->SetBuildingType (Building::Commercial);
+    building->SetExtWallsType (Building::ConcreteWithWindows);
+    m_buildings.push_back (building);
+
+    m_buildingNodes[b].Create (m_params.nodesPerBuilding);
+    m_nodes.Add (m_buildingNodes[b]);
+
+    //Each node gets exactly one mobility model, starting at its slot
+    std::ostringstream bounds;
+    bounds << box.xMin << "|" << box.xMax << "|" << box.yMin << "|" << box.yMax;
+    std::ostringstream speed;
+    speed << "ns3::ConstantRandomVariable[Constant=" << m_params.walkSpeed << "]";
+    MobilityHelper walk;
+    walk.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
+                           "Mode", StringValue ("Time"),
+                           "Time", StringValue ("2s"),
+                           "Speed", StringValue (speed.str ()),
+                           "Bounds", StringValue (bounds.str ()));
+    for (uint32_t i = 0; i < m_params.nodesPerBuilding; i++) {
+      Ptr<ListPositionAllocator> position = CreateObject<ListPositionAllocator> ();
+      position->Add (GetNodePosition (box, i));
+      bool relay = i == 0 && m_params.staticCorners;
+      MobilityHelper &helper = relay ? fixed : walk;
+      helper.SetPositionAllocator (position);
+      helper.Install (m_buildingNodes[b].Get (i));
+      m_nodeBuilding.push_back (b);
+      m_nodeRoles.push_back (relay ? ScenarioNode::RELAY : 0);
+    }
+  }
+
+  m_baseStation = 0;
+  if (m_params.baseStation) {
+    //Middle of the street crossing nearest the campus center
+    Box bounds = GetBounds ();
+    double pitchX = m_params.width + m_params.street, pitchY = m_params.depth + m_params.street;
+    double mx = (bounds.xMin + bounds.xMax) / 2, my = (bounds.yMin + bounds.yMax) / 2;
+    double x = std::max (1.0, std::floor ((mx + m_params.street / 2) / pitchX + 0.5)) * pitchX - m_params.street / 2;
+    double y = std::max (1.0, std::floor ((my + m_params.street / 2) / pitchY + 0.5)) * pitchY - m_params.street / 2;
+    m_baseStation = CreateObject<Node> ();
+    m_nodes.Add (m_baseStation);
+    Ptr<ListPositionAllocator> position = CreateObject<ListPositionAllocator> ();
+    position->Add (Vector (x, y, 0));
+    fixed.SetPositionAllocator (position);
+    fixed.Install (m_baseStation);
+    m_nodeBuilding.push_back (-1);
+    m_nodeRoles.push_back (ScenarioNode::BASE_STATION);
+  }
+
+  BuildingsHelper::Install (m_nodes);
+}
+
+//Creates the models directly instead of through MobilityHelper and
+//position allocators, which would cost a few objects and an attribute
+//string parse per node
+inline void CampusScenario::Load () {
+  ScenarioFile file;
+  NS_ABORT_MSG_UNLESS (file.Open (m_params.scenarioFile), "Cannot read scenario file " << m_params.scenarioFile);
+  const ScenarioHeader &header = file.GetHeader ();
+  m_bounds = Box (header.bounds[0], header.bounds[1], header.bounds[2],
+                  header.bounds[3], header.bounds[4], header.bounds[5]);
+  m_nodes = NodeContainer ();
+  m_buildingNodes.assign (header.buildings, NodeContainer ());
+  m_buildings.clear ();
+  m_buildings.reserve (header.buildings);
+  m_baseStation = 0;
+
+  const ScenarioBuilding *buildings = file.GetBuildings ();
+  for (uint32_t b = 0; b < header.buildings; b++) {
+    const ScenarioBuilding &r = buildings[b];
+    NS_ABORT_MSG_IF (r.type > Building::Commercial || r.walls > Building::StoneBlocks,
+                     "Bad building type or wall type in " << m_params.scenarioFile);
+    Ptr<Building> building = CreateObject<Building> ();
+    building->SetBoundaries (Box (r.box[0], r.box[1], r.box[2], r.box[3], r.box[4], r.box[5]));
+    building->SetBuildingType ((Building::BuildingType_t)r.type);
+    building->SetExtWallsType ((Building::ExtWallsType_t)r.walls);
+    building->SetNFloors (std::max<uint16_t> (r.floors, 1));
+    building->SetNRoomsX (std::max<uint16_t> (r.roomsX, 1));
+    building->SetNRoomsY (std::max<uint16_t> (r.roomsY, 1));
+    m_buildings.push_back (building);
+  }
+
+  ObjectFactory fixed;
+  fixed.SetTypeId ("ns3::ConstantPositionMobilityModel");
+  ObjectFactory walk;
+  walk.SetTypeId ("ns3::RandomWalk2dMobilityModel");
+  walk.Set ("Mode", EnumValue (RandomWalk2dMobilityModel::MODE_TIME));
+  walk.Set ("Time", TimeValue (Seconds (2)));
+  m_nodes.Create (header.nodes);
+  m_nodeBuilding.resize (header.nodes);
+  m_nodeRoles.resize (header.nodes);
+  const ScenarioNode *nodes = file.GetNodes ();
+  uint32_t firstBaseStation = file.GetNBuildingNodes ();
+  for (uint32_t i = 0; i < header.nodes; i++) {
+    const ScenarioNode &r = nodes[i];
+    Ptr<Node> node = m_nodes.Get (i);
+    NS_ABORT_MSG_IF (r.building >= (int32_t)header.buildings, "Node " << i << " in unknown building " << r.building);
+    NS_ABORT_MSG_IF (((r.roles & ScenarioNode::BASE_STATION) != 0) != (i >= firstBaseStation),
+                     "Base stations must be the last nodes of " << m_params.scenarioFile);
+    Ptr<MobilityModel> mobility;
+    if (r.mobility == ScenarioNode::WALK) {
+      Ptr<ConstantRandomVariable> speed = CreateObject<ConstantRandomVariable> ();
+      speed->SetAttribute ("Constant", DoubleValue (r.speed));
+      walk.Set ("Speed", PointerValue (speed));
+      walk.Set ("Bounds", RectangleValue (Rectangle (r.walk[0], r.walk[1], r.walk[2], r.walk[3])));
+      mobility = walk.Create<MobilityModel> ();
+    } else {
+      mobility = fixed.Create<MobilityModel> ();
+    }
+    node->AggregateObject (mobility);
+    mobility->SetPosition (Vector (r.position[0], r.position[1], r.position[2]));
+    if (r.building >= 0) {
+      m_buildingNodes[r.building].Add (node);
+    }
+    if ((r.roles & ScenarioNode::BASE_STATION) && m_baseStation == 0) {
+      m_baseStation = node;
+    }
+    m_nodeBuilding[i] = r.building;
+    m_nodeRoles[i] = r.roles;
+  }
+
+  BuildingsHelper::Install (m_nodes);
+}
+
+} // namespace ns3
+
+#endif /* CAMPUS_SCENARIO_H */
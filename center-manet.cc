@@ -31,9 +31,10 @@
 //LAB 2
 //IAN ROBERTS AND ANNA CASE
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
-#include <ctime>
+#include <sstream>
 #include <cstdlib>
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
@@ -52,6 +53,22 @@
 #include "ns3/propagation-delay-model.h"
 #include "ns3/buildings-propagation-loss-model.h"
 #include "ns3/buildings-helper.h"
+#include "parallel-runs.h"
+#include "throughput-log.h"
+#include "grid-wifi-channel.h"
+#include "building-index.h"
+#include "campus-scenario.h"
+#include "route-convergence.h"
+#include "traffic-source.h"
+#include "run-stats.h"
+#include "flow-window-stats.h"
+#include "flow-latency.h"
+#include "flow-export.h"
+#include "flow-probe.h"
+#include "node-index.h"
+#include "collector-sink.h"
+#include "building-wall-loss-model.h"
+#include "cached-loss-model.h"
 
 using namespace ns3;
 using namespace dsr;
@@ -61,14 +78,22 @@ NS_LOG_COMPONENT_DEFINE ("manet");
 class RoutingExperiment {
 public:
   RoutingExperiment ();
-  void Run (string CSVfileName, int p);
+  //False when a warm-start branch failed
+  bool Run (string CSVfileName, int p);
   //static void SetMACParam (ns3::NetDeviceContainer & devices,
   //                                 int slotDistance);
   string CommandSetup (int argc, char **argv);
+  void DrawFlows ();
+  bool IsParallel () const { return m_parallel; }
+  //Protocols to run: all three, or the one picked with --protocol
+  vector<int> GetProtocols () const;
+  void SetShard (string shard) { m_shard = shard; }
+  ThroughputLog::Format GetOutputFormat () const { return m_format; }
 
 private:
   Ptr<Socket> SetupPacketReceive (Ipv4Address addr, Ptr<Node> node);
   void ReceivePacket (Ptr<Socket> socket);
+  void CollectPacket (Ptr<const Packet> packet, uint32_t bytes);
   void CheckThroughput ();
 
   uint32_t port;
@@ -78,13 +103,43 @@ private:
   int m_nSinks;
   double m_txp;
   bool m_traceMobility;
+  bool m_metadata;
+  bool m_pcap;
+  bool m_verbose;
   uint32_t m_time;
   uint32_t m_numP;
   uint32_t m_pSize;
   Time     m_pInt;
+  string m_trafficModeName;
+  TrafficSource::Mode m_trafficMode;
   uint32_t m_nSep;
   uint32_t m_pRec;
   uint32_t m_bTot;
+  uint64_t m_delivered;
+  uint64_t m_deliveredBytes;
+  double m_flowWindow;
+  FlowWindowStats m_windows;
+  FlowLatency m_latency;
+  string m_histFile;
+  bool m_flowHistograms;
+  string m_flowmonMode;
+  bool m_convergecast;
+  int m_nSources;
+  uint32_t m_flowSample;
+  int m_protocol;
+  bool m_parallel;
+  bool m_buildingLoss;
+  string m_shard;
+  string m_outputFormat;
+  ThroughputLog::Format m_format;
+  ThroughputLog m_log;
+  vector<vector<pair<int, int> > > m_flows;
+  CampusParams m_campus;
+  double m_warmup;
+  bool m_converge;
+  double m_convergeWindow;
+  string m_nSinksList;
+  vector<int> m_sinksList;
 };
 //Set member variables
 RoutingExperiment::RoutingExperiment ()
@@ -94,14 +149,38 @@ RoutingExperiment::RoutingExperiment ()
     m_nSinks (3),
     m_txp(15),
     m_traceMobility (false),
+    m_metadata (false),
+    m_pcap (false),
+    m_verbose (false),
     m_time (55),
     m_numP (0),
     m_pSize (50),
     m_pInt (1000000),
+    m_trafficModeName ("cbr"),
+    m_trafficMode (TrafficSource::CBR),
     m_nSep (2),
     m_pRec (0),
-    m_bTot (0)
+    m_bTot (0),
+    m_delivered (0),
+    m_deliveredBytes (0),
+    m_flowWindow (0),
+    m_flowHistograms (false),
+    m_flowmonMode ("data"),
+    m_convergecast (false),
+    m_nSources (0),
+    m_flowSample (1),
+    m_protocol (0),
+    m_parallel (true),
+    m_buildingLoss (true),
+    m_outputFormat ("csv"),
+    m_format (ThroughputLog::CSV),
+    m_warmup (50.0),
+    m_converge (false),
+    m_convergeWindow (5.0)
 {
+  //Corner relays plus a base station in the middle of the crossing
+  m_campus.staticCorners = true;
+  m_campus.baseStation = true;
 }
 
 Ptr<Socket> RoutingExperiment::SetupPacketReceive (Ipv4Address addr, Ptr<Node> node) {
@@ -133,21 +212,36 @@ void RoutingExperiment::ReceivePacket (Ptr<Socket> socket) {
   while ((packet = socket->RecvFrom (senderAddress))) {
     m_bTot += packet->GetSize ();
     m_pRec += 1;
-//    NS_LOG_UNCOND (PrintReceivedPacket (socket, packet, senderAddress));
+    m_delivered++;
+    m_deliveredBytes += packet->GetSize ();
+    m_latency.Rx (packet);
+    if (m_flowWindow > 0) {
+      m_windows.Rx (packet);
+    }
+    if (m_verbose) {
+      NS_LOG_UNCOND (PrintReceivedPacket (socket, packet, senderAddress));
+    }
+    PacketPool::Default ().Recycle (packet);
+  }
+}
+
+//Convergecast: counts what the base station collector takes in
+void RoutingExperiment::CollectPacket (Ptr<const Packet> packet, uint32_t bytes) {
+  m_bTot += bytes;
+  m_pRec += 1;
+  m_delivered++;
+  m_deliveredBytes += bytes;
+  m_latency.Rx (packet, bytes);
+  if (m_flowWindow > 0) {
+    m_windows.Rx (packet, bytes);
   }
 }
 
-//Prints to CSV file
+//Buffers one CSV row, written out in blocks and at the end of Run
 void RoutingExperiment::CheckThroughput () {
   double kbs = (m_bTot * 8.0) / 1000;
   m_bTot = 0;
-  ofstream out (CSVfileName.c_str (), ios::app);
-  out << (Simulator::Now ()).GetSeconds () << " , "
-      << kbs << " , " << m_pRec << " , "
-      << m_nSinks << " , " << m_proto << " , "
-      << m_txp << endl;
-
-  out.close ();
+  m_log.Add (Simulator::Now ().GetSeconds (), kbs, m_pRec, m_nSinks, m_proto, m_txp);
   m_pRec = 0;
   Simulator::Schedule (Seconds (1.0), &RoutingExperiment::CheckThroughput, this);
 }
@@ -157,165 +251,184 @@ string RoutingExperiment::CommandSetup (int argc, char **argv) {
   CommandLine cmd;
   cmd.AddValue ("CSVfileName", "The name of the CSV output file name", CSVfileName);
   cmd.AddValue ("traceMobility", "Enable mobility tracing", m_traceMobility);
+  cmd.AddValue ("metadata", "keep packet metadata (Packet::EnablePrinting)", m_metadata);
+  cmd.AddValue ("pcap", "write pcap traces of every wifi device", m_pcap);
+  cmd.AddValue ("verbose", "log every received packet and the manet log component", m_verbose);
   cmd.AddValue ("power", "Tx power dBm", m_txp);
   cmd.AddValue ("time", "simulation time", m_time);
-  cmd.AddValue ("numP", "number of packets", m_numP);
+  cmd.AddValue ("numP", "number of packets per flow, 0 for no limit", m_numP);
   cmd.AddValue ("pSize", "packet size", m_pSize);
   cmd.AddValue ("pInt", "interpacket interval", m_pInt);
+  cmd.AddValue ("trafficMode", "packet gaps: cbr, poisson (mean pInt) or onoff (1 s on, 1 s off)", m_trafficModeName);
   cmd.AddValue ("nSinks", "number of sinks", m_nSinks);
   cmd.AddValue ("nSep", "separation of nodes", m_nSep);
+  cmd.AddValue ("parallel", "run the three protocols in parallel processes", m_parallel);
+  cmd.AddValue ("protocol", "run only this protocol (1 OLSR, 2 AODV, 3 DSDV), 0 for all", m_protocol);
+  cmd.AddValue ("buildingLoss", "add wall penetration loss between buildings", m_buildingLoss);
+  cmd.AddValue ("outputFormat", "throughput output, csv or bin (TPB1 blocks, see throughput-log.h)", m_outputFormat);
+  cmd.AddValue ("nSinksList", "warm start: simulate the routing warm-up once, then fork one run per nSinks in this list (e.g. 1,2,3)", m_nSinksList);
+  cmd.AddValue ("flowWindow", "seconds per window of the streamed per-flow stats (Window lines), 0 for none", m_flowWindow);
+  cmd.AddValue ("histFile", "write the delay and jitter histograms to <histFile>.<protocol> (see hist-merge)", m_histFile);
+  cmd.AddValue ("flowHistograms", "append the delay and jitter histograms to the .flows files", m_flowHistograms);
+  cmd.AddValue ("flowmon", "flow statistics of the data port only (data) or of all IPv4 traffic with FlowMonitor (all)", m_flowmonMode);
+  cmd.AddValue ("flowSample", "data flowmon: follow 1 in this many packets and scale the estimates (no jitter above 1)", m_flowSample);
+  cmd.AddValue ("convergecast", "every source (see nSources) reports to the base station, which counts without a socket buffer", m_convergecast);
+  cmd.AddValue ("nSources", "convergecast sources, 0 for every building node", m_nSources);
+  cmd.AddValue ("converge", "start traffic once the routing tables are stable, at 50 s at the latest", m_converge);
+  cmd.AddValue ("convergeWindow", "seconds without routing table changes that count as converged", m_convergeWindow);
+  m_campus.AddValues (cmd);
   cmd.Parse (argc, argv);
-  return CSVfileName;
-}
-
-static void GenerateTraffic (Ptr<Socket> socket, uint32_t m_pSize, uint32_t pktCount, Time m_pInt ) {
-  if (pktCount >=0) {
-    socket->Send (Create<Packet> (m_pSize));
-    Simulator::Schedule (m_pInt, &GenerateTraffic,
-                         socket, m_pSize,pktCount-1, m_pInt);
-  } else {
-    socket->Close ();
+  replace (m_nSinksList.begin (), m_nSinksList.end (), ',', ' ');
+  istringstream sinks (m_nSinksList);
+  int k;
+  while (sinks >> k) {
+    m_sinksList.push_back (k);
+  }
+  if (!m_sinksList.empty ()) {
+    //flows are drawn for the largest set, smaller sets use a prefix of it
+    m_nSinks = *max_element (m_sinksList.begin (), m_sinksList.end ());
+  }
+  m_campus.nSep = m_nSep;
+  if (m_verbose) {
+    LogComponentEnable ("manet", LOG_LEVEL_INFO);
+  }
+  if (!TrafficSource::ParseMode (m_trafficModeName, m_trafficMode)) {
+    NS_FATAL_ERROR ("Unknown trafficMode " << m_trafficModeName);
+  }
+  if (m_convergecast && !m_sinksList.empty ()) {
+    NS_FATAL_ERROR ("convergecast has one sink, it does not combine with nSinksList");
   }
+  if (m_flowmonMode != "data" && m_flowmonMode != "all") {
+    NS_FATAL_ERROR ("Unknown flowmon " << m_flowmonMode);
+  }
+  if (m_protocol < 0 || m_protocol > 3) {
+    NS_FATAL_ERROR ("Unknown protocol " << m_protocol);
+  }
+  if (!ThroughputLog::ParseFormat (m_outputFormat, m_format)) {
+    NS_FATAL_ERROR ("Unknown outputFormat " << m_outputFormat);
+  }
+  return CSVfileName;
 }
 
 int main (int argc, char *argv[]) {
-  srand (time(NULL));
   RoutingExperiment experiment;
   string CSVfileName = experiment.CommandSetup (argc,argv);
   //blank out the last output file and write the column headers
   ofstream out (CSVfileName.c_str ());
-  out << "SimulationSecond," << "ReceiveRate," <<
-  "PacketsReceived," << "NumberOfSinks," <<
-  "RoutingProtocol," << "TransmissionPower" << endl;
+  if (experiment.GetOutputFormat () == ThroughputLog::CSV) {
+    out << "SimulationSecond," << "ReceiveRate," <<
+    "PacketsReceived," << "NumberOfSinks," <<
+    "RoutingProtocol," << "TransmissionPower" << endl;
+  }
   out.close ();
+  experiment.DrawFlows ();
+  vector<int> protocols = experiment.GetProtocols ();
+  //A failed protocol run fails the program, so sweeps do not keep its output
+  bool ok = true;
+  if (experiment.IsParallel () && protocols.size () > 1) {
+    ok = ForkRuns (protocols, [&] (int p) {
+                     experiment.SetShard (ShardSuffix (p));
+                     if (!experiment.Run (CSVfileName, p)) {
+                       exit (1);
+                     }
+                   }, CSVfileName);
+  } else {
+    for (size_t i = 0; i < protocols.size (); i++) {
+      ok = experiment.Run (CSVfileName, protocols[i]) && ok;
+    }
+  }
+  return ok ? 0 : 1;
+}
+
+vector<int> RoutingExperiment::GetProtocols () const {
+  vector<int> protocols;
+  for (int p=1; p<4; p++) {
+    if (m_protocol == 0 || m_protocol == p) {
+      protocols.push_back (p);
+    }
+  }
+  return protocols;
+}
+
+//Picks the sink/source pairs of every protocol before any run starts, so
+//forked runs get the same pairs as the serial loop. The draw has its own
+//stream, well above the ones Run assigns from 0, so it only depends on
+//--RngSeed and --RngRun.
+void RoutingExperiment::DrawFlows () {
+  int si,so;
+  int nNodes = CampusScenario::GetNBuildingNodes (m_campus);
+  Ptr<UniformRandomVariable> pick = CreateObject<UniformRandomVariable> ();
+  pick->SetStream (100000);
+  m_flows.assign (4, vector<pair<int, int> > ());
+  if (m_convergecast) {
+    //The base station is the node after the building nodes; sources are
+    //the first nSources of a shuffle of the building nodes
+    int n = m_nSources > 0 ? min (m_nSources, nNodes) : nNodes;
+    for (int p=1; p<4; p++) {
+      vector<int> order (nNodes);
+      for (int i=0; i<nNodes; i++) {
+        order[i] = i;
+      }
+      for (int i=0; i<n; i++) {
+        swap (order[i], order[pick->GetInteger (i, nNodes - 1)]);
+        m_flows[p].push_back (make_pair (nNodes, order[i]));
+      }
+    }
+    return;
+  }
+  //a sink and a distinct source need two building nodes
+  if (m_nSinks > 0 && nNodes < 2) {
+    NS_FATAL_ERROR ("nSinks " << m_nSinks << " needs at least 2 building nodes, the campus has " << nNodes);
+  }
   for (int p=1; p<4; p++) {
-    experiment.Run (CSVfileName, p);
+    for (int i=0; i<m_nSinks; i++) {
+      si = pick->GetInteger (0, nNodes - 1);
+      do {
+        so = pick->GetInteger (0, nNodes - 1);
+      } while (si==so);
+      m_flows[p].push_back (make_pair (si, so));
+    }
   }
 }
 
-void RoutingExperiment::Run (string CSVfileName, int p) {
-  Packet::EnablePrinting ();
-  int nBuilding = 10;
-  double stories = 10;
-  double naught = 0;
-  double x1 = 100;
-  double x2 = 125;
-  double x3 = 225;
-  double y1 = 50;
-  double y2 = 75;
-  double y3 = 125;
-  int pktCount = m_numP;
+bool RoutingExperiment::Run (string CSVfileName, int p) {
+  //The pool outlives a run; its counters should not
+  PacketPool::Default ().ResetStats ();
+  //Fast by default: metadata, pcap and logging only when asked for
+  if (m_metadata) {
+    Packet::EnablePrinting ();
+  }
   string size ("64");
   string rate ("2048bps");
   string phyMode ("DsssRate11Mbps");
-  string tr_name ("manet");
+  string tr_name ("center-manet");
   string pName ("protocol");
 
   Config::SetDefault  ("ns3::OnOffApplication::PacketSize",StringValue (size));
   Config::SetDefault ("ns3::OnOffApplication::DataRate",  StringValue (rate));
   Config::SetDefault ("ns3::WifiRemoteStationManager::NonUnicastMode",StringValue (phyMode));
 
-  //Create node containers for each building and one for all nodes
-  NodeContainer bs, b1, b2, b3, b4, adhocNodes;
-  b1.Create (nBuilding);
-  adhocNodes.Add(b1);
-  b2.Create (nBuilding);
-  adhocNodes.Add(b2);
-  b3.Create (nBuilding);
-  adhocNodes.Add(b3);
-  b4.Create (nBuilding);
-  adhocNodes.Add(b4);
-  bs.Create (1);
-  adhocNodes.Add(bs);
-
-  MobilityHelper mobility, walk;
-  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
-  positionAlloc->Add (Vector(x1,y1,0));
-  for (int one=1; one<nBuilding; one++)
-    positionAlloc->Add (Vector (x1, y1-one*m_nSep, 0.0));
-  positionAlloc->Add(Vector(x2,y1,0));
-  for (int two=1; two<nBuilding; two++)
-    positionAlloc->Add (Vector (x2, y1-two*m_nSep, 0.0));
-  positionAlloc->Add (Vector (x2,y2,0));
-  for (int three=1; three<nBuilding; three++)
-    positionAlloc->Add (Vector (x2,y2+three*m_nSep,0.0));
-  positionAlloc->Add (Vector (x1,y2,0));
-  for (int four=1; four<nBuilding; four++)
-    positionAlloc->Add (Vector (x2,y2+four*m_nSep,0.0));
-  positionAlloc->Add (Vector (112,62,0));
-  mobility.SetPositionAllocator (positionAlloc);
-  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-  mobility.Install (adhocNodes);
-
-  //Bounds for building 1
-  walk.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
-                             "Mode", StringValue ("Time"),
-                             "Time", StringValue ("2s"),
-                             "Speed", StringValue ("ns3::ConstantRandomVariable[Constant=1.0]"),
-                             "Bounds", StringValue ("0|100|0|50"));
-  walk.Install(b1);
-
-  //Bounds for building 2
-  walk.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
-                             "Mode", StringValue ("Time"),
-                             "Time", StringValue ("2s"),
-                             "Speed", StringValue ("ns3::ConstantRandomVariable[Constant=1.0]"),
-                             "Bounds", StringValue ("125|225|0|50"));
-  walk.Install(b2);
-
-  //Bounds for building 3
-  walk.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
-                             "Mode", StringValue ("Time"),
-                             "Time", StringValue ("2s"),
-                             "Speed", StringValue ("ns3::ConstantRandomVariable[Constant=1.0]"),
-                             "Bounds", StringValue ("125|225|75|125"));
-  walk.Install(b3);
-
-  //Bounds for building 4
-  walk.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
-                             "Mode", StringValue ("Time"),
-                             "Time", StringValue ("2s"),
-                             "Speed", StringValue ("ns3::ConstantRandomVariable[Constant=1.0]"),
-                             "Bounds", StringValue ("0|100|75|125"));
-  walk.Install(b4);
-
-
-  Ptr<Building> Building1 = CreateObject<Building> ();
-  Building1->SetBoundaries (Box (naught, x1, naught, y1, naught, stories));
-  Building1->SetBuildingType(Building::Commercial);
-  Building1->SetExtWallsType(Building::ConcreteWithWindows);
-  Ptr<MobilityBuildingInfo> b1Info = CreateObject<MobilityBuildingInfo> ();
-  BuildingsHelper::Install(b1);
-
-  Ptr<Building> Building2 = CreateObject<Building> ();
-  Building2->SetBoundaries (Box (x2, x3, naught, y1, naught, stories));
-  Building2->SetBuildingType(Building::Commercial);
-  Building2->SetExtWallsType(Building::ConcreteWithWindows);
-  Ptr<MobilityBuildingInfo> b2Info = CreateObject<MobilityBuildingInfo> ();
-  BuildingsHelper::Install(b2);
-
-  Ptr<Building> Building3 = CreateObject<Building> ();
-  Building3->SetBoundaries (Box (x2, x3, y2, y3, naught, stories));
-  Building3->SetBuildingType(Building::Commercial);
-  Building3->SetExtWallsType(Building::ConcreteWithWindows);
-  Ptr<MobilityBuildingInfo> b3Info = CreateObject<MobilityBuildingInfo> ();
-  BuildingsHelper::Install(b3);
-
-  Ptr<Building> Building4 = CreateObject<Building> ();
-  Building4->SetBoundaries (Box (naught, x1, y2, y3, naught, stories));
-  Building4->SetBuildingType(Building::Commercial);
-  Building4->SetExtWallsType(Building::ConcreteWithWindows);
-  Ptr<MobilityBuildingInfo> b4Info = CreateObject<MobilityBuildingInfo> ();
-  BuildingsHelper::Install(b4);
-
-  Ptr<MobilityBuildingInfo> bsInfo = CreateObject<MobilityBuildingInfo> ();
-  bsInfo->SetOutdoor();
-  BuildingsHelper::Install(bs);
-
-  //Performs consistency check on all nodes
-  BuildingsHelper::MakeMobilityModelConsistent ();
-
-  Ptr<FriisPropagationLossModel> lossModel = CreateObject<FriisPropagationLossModel> ();
+  //Buildings, nodes and their mobility from the campus parameters
+  CampusScenario campus (m_campus);
+  campus.Build ();
+  NodeContainer adhocNodes = campus.GetNodes ();
+
+  //Performs consistency check on all nodes, indexing the buildings once
+  Ptr<BuildingIndex> buildingIndex = Create<BuildingIndex> ();
+  buildingIndex->Build ();
+  buildingIndex->MakeConsistent ();
+
+  //Caches Friis between static nodes (corner relays, base station)
+  Ptr<CachedPropagationLossModel> friis = CreateObject<CachedPropagationLossModel> ();
+  friis->SetCachedModel (CreateObject<FriisPropagationLossModel> ());
+  Ptr<PropagationLossModel> lossModel = friis;
+  if (m_buildingLoss) {
+    //Wall penetration between the buildings on top of Friis
+    Ptr<BuildingWallLossModel> walls = CreateObject<BuildingWallLossModel> ();
+    walls->SetBuildingIndex (buildingIndex);
+    walls->SetNext (lossModel);
+    lossModel = walls;
+  }
 
   //set up wifi using helpers
   WifiHelper wifi;
@@ -324,10 +437,11 @@ void RoutingExperiment::Run (string CSVfileName, int p) {
                                 "DataMode",StringValue (phyMode),
                                 "ControlMode",StringValue (phyMode));
 
-  Ptr<YansWifiChannel> wifiChannel = CreateObject <YansWifiChannel> ();
+  //Channel only delivers to receivers within range of TxPowerStart
+  Ptr<GridWifiChannel> wifiChannel = CreateObject <GridWifiChannel> ();
   wifiChannel->SetPropagationLossModel (lossModel);
   wifiChannel->SetPropagationDelayModel (CreateObject <ConstantSpeedPropagationDelayModel> ());
-  YansWifiPhyHelper wifiPhy =  YansWifiPhyHelper::Default ();
+  GridWifiPhyHelper wifiPhy (YansWifiPhyHelper::Default ());
   wifiPhy.SetChannel (wifiChannel);
 
   //Minimum and maximum TX power
@@ -337,6 +451,11 @@ void RoutingExperiment::Run (string CSVfileName, int p) {
   WifiMacHelper wifiMac;
   wifiMac.SetType ("ns3::AdhocWifiMac");
   NetDeviceContainer adhocDevices = wifi.Install (wifiPhy, wifiMac, adhocNodes);
+  if (m_pcap) {
+    wifiPhy.EnablePcapAll (tr_name + m_shard);
+  }
+  RunStats runStats;
+  runStats.Install ();
 
   //Handles Routing
   AodvHelper aodv;
@@ -361,6 +480,8 @@ void RoutingExperiment::Run (string CSVfileName, int p) {
       NS_FATAL_ERROR ("No such protocol");
   }
   m_proto = p;
+  //Warm-up rows stay buffered so warm-start branches can relabel them
+  m_log.Open (CSVfileName + m_shard, m_format, m_sinksList.empty () ? 4096 : 0);
   CheckThroughput();
   cout << "~~~~~~~~~~~~~~~~~" << pName << "~~~~~~~~~~~~~~~~~~\n";
 
@@ -372,56 +493,271 @@ void RoutingExperiment::Run (string CSVfileName, int p) {
   addressAdhoc.SetBase ("10.0.0.0", "255.255.255.0");
   Ipv4InterfaceContainer adhocInterfaces;
   adhocInterfaces = addressAdhoc.Assign (adhocDevices);
+  NodeIndex nodeIndex;
+  nodeIndex.Build (adhocInterfaces, adhocNodes, campus);
+
+  //Fixed streams so a protocol draws the same numbers serially or forked
+  int64_t stream = 0;
+  stream += campus.AssignStreams (stream);
+  stream += wifi.AssignStreams (adhocDevices, stream);
+  stream += wifiChannel->AssignStreams (stream);
+  stream += internet.AssignStreams (adhocNodes, stream);
+  switch (p) {
+    case 1:
+      stream += olsr.AssignStreams (adhocNodes, stream);
+      break;
+    case 2:
+      stream += aodv.AssignStreams (adhocNodes, stream);
+      break;
+    case 3:
+      for (uint32_t n=0; n<adhocNodes.GetN (); n++) {
+        int16_t priority;
+        Ptr<Ipv4ListRouting> routing = DynamicCast<Ipv4ListRouting> (adhocNodes.Get (n)->GetObject<Ipv4> ()->GetRoutingProtocol ());
+        stream += DynamicCast<dsdv::RoutingProtocol> (routing->GetRoutingProtocol (0, priority))->AssignStreams (stream);
+      }
+      break;
+  }
 
 
-  TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
-  int si,so;
-  for (int i=0; i<m_nSinks; i++) {
-    si = rand () % 40;
-    do {
-      so = rand () % 40;
-    } while (si==so);
-    cout << "Sink: " << si << " " << "Source: " <<so << "\n";
-    Ptr<Socket> sink = SetupPacketReceive (adhocInterfaces.GetAddress (si), adhocNodes.Get (si));
-    Ptr<Socket> source = Socket::CreateSocket (adhocNodes.Get(so), tid);
-    InetSocketAddress remote = InetSocketAddress (adhocInterfaces.GetAddress (si, 0), port);
-    source->Connect (remote);
-    Simulator::Schedule (Seconds (50.0+i), &GenerateTraffic,
-                         source, m_pSize, pktCount, m_pInt);
+  //Traffic starts at m_warmup unless the convergence detector starts it earlier
+  Time trafficStart = Seconds (m_warmup);
+  Time trafficTime = Seconds (m_time) - trafficStart;
+  RouteConvergence convergence;
+  convergence.SetWindow (Seconds (m_convergeWindow));
+  convergence.SetDeadline (trafficStart);
+  auto converged = [&] () {
+    trafficStart = Simulator::Now ();
+    cout << (convergence.IsConverged () ? "Routes converged at " : "Routes still changing at ")
+         << trafficStart.GetSeconds () << " s\n";
+  };
+
+  //Convergecast sink: one collector on the base station for every flow
+  CollectorSink collector;
+  if (m_convergecast) {
+    if (campus.GetBaseStation () == 0) {
+      NS_FATAL_ERROR ("convergecast needs a base station in the campus");
+    }
+    collector.SetCallback (MakeCallback (&RoutingExperiment::CollectPacket, this));
+    collector.Install (campus.GetBaseStation (), port);
   }
 
-  //Installs flow monitor on the nodes
+  //Sinks and sources of the first m_nSinks flows (every convergecast
+  //flow), sending from trafficStart on
+  vector<Ptr<TrafficSource> > sources;
+  auto startFlows = [&] () {
+    int si,so;
+    int nFlows = m_convergecast ? (int)m_flows[p].size () : m_nSinks;
+    m_latency.Start (nFlows);
+    if (m_flowWindow > 0) {
+      m_windows.SetWindow (Seconds (m_flowWindow));
+      m_windows.SetLabel (pName);
+      m_windows.Start (nFlows, trafficStart);
+    }
+    for (int i=0; i<nFlows; i++) {
+      si = m_flows[p][i].first;
+      so = m_flows[p][i].second;
+      if (m_flowWindow > 0) {
+        m_windows.SetEndpoints (i, nodeIndex.Get (so).node, nodeIndex.Get (so).building,
+                                nodeIndex.Get (si).node, nodeIndex.Get (si).building);
+      }
+      if (!m_convergecast) {
+        cout << "Sink: " << si << " " << "Source: " <<so << "\n";
+      }
+      nodeIndex.AddRole (si, NodeInfo::SINK);
+      nodeIndex.AddRole (so, NodeInfo::SOURCE);
+      if (!m_convergecast) {
+        SetupPacketReceive (adhocInterfaces.GetAddress (si), adhocNodes.Get (si));
+      }
+      InetSocketAddress remote = InetSocketAddress (adhocInterfaces.GetAddress (si, 0), port);
+      Ptr<TrafficSource> source = CreateObject<TrafficSource> ();
+      source->SetAttribute ("Remote", AddressValue (remote));
+      source->SetAttribute ("PacketSize", UintegerValue (m_pSize));
+      source->SetAttribute ("Interval", TimeValue (m_pInt));
+      source->SetAttribute ("MaxPackets", UintegerValue (m_numP));
+      source->SetAttribute ("Mode", EnumValue (m_trafficMode));
+      source->SetAttribute ("FlowId", UintegerValue (i));
+      source->SetAttribute ("Timestamp", BooleanValue (true));
+      stream += source->AssignStreams (stream);
+      adhocNodes.Get (so)->AddApplication (source);
+      sources.push_back (source);
+      if (m_flowWindow > 0) {
+        m_windows.Watch (source);
+      }
+      //Flows start a second apart, convergecast ones spread over the first second
+      Time offset = m_convergecast ? Seconds ((double)i / nFlows) : Seconds (i);
+      source->SetStartTime (trafficStart + offset - Simulator::Now ());
+    }
+    if (m_convergecast) {
+      cout << "Convergecast: " << nFlows << " sources to the base station\n";
+    }
+  };
+
+  //Flow statistics: the UDP data flows only, or every IPv4 flow with FlowMonitor
   FlowMonitorHelper flowmon;
-  Ptr<FlowMonitor> monitor = flowmon.InstallAll ();
+  Ptr<FlowMonitor> monitor;
+  DataFlowProbe probe;
+  if (m_flowmonMode == "all") {
+    monitor = flowmon.InstallAll ();
+  } else {
+    probe.SetProtocol (UdpL4Protocol::PROT_NUMBER);
+    probe.AddPort (port);
+    probe.SetSampling (m_flowSample);
+    probe.Install (adhocNodes);
+  }
 
   //Runs the simulations and shows output
-  Simulator::Stop (Seconds (m_time));
-  Simulator::Run ();
-  monitor->CheckForLostPackets ();
-  Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowmon.GetClassifier ());
-  FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats ();
-  for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin (); i != stats.end (); ++i) {
-    Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (i->first);
-    // $$$$$$$$$ How can we determine the node from the address?
-    cout << "Flow:               " << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-    cout << "  Tx Packets:       " << i->second.txPackets << "\n";
-    cout << "  Tx Bytes:         " << i->second.txBytes << "\n";
-    cout << "  Rx Packets:       " << i->second.rxPackets << "\n";
-    cout << "  Rx Bytes:         " << i->second.rxBytes << "\n";
-    cout << "  Packet Loss:      " << i->second.txPackets -i->second.rxPackets << "\n";
-    if (i->second.rxPackets > 0) {
-      Time delay = i->second.delaySum/i->second.rxPackets;
-      Time jitter = i->second.jitterSum/i->second.rxPackets;
-      if (i->second.delaySum > 0 && i->second.rxBytes > 0) {
-        cout << "  Throughput:       " << 1000* (i->second.rxBytes * 8) / (i->second.delaySum) << "Mbps \n";
-      } else {
-        cout << "  Throughput:       0 bps \n";
+  auto finish = [&] () {
+    Simulator::Stop (trafficStart + trafficTime - Simulator::Now ());
+    Simulator::Run ();
+    m_log.Flush ();
+    if (m_flowWindow > 0) {
+      m_windows.Flush ();
+    }
+    vector<FlowRecord> records;
+    if (monitor != 0) {
+      monitor->CheckForLostPackets ();
+      Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowmon.GetClassifier ());
+      FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats ();
+      for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin (); i != stats.end (); ++i) {
+        Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (i->first);
+        FlowRecord record;
+        record.flowId = i->first;
+        record.source = t.sourceAddress.Get ();
+        record.destination = t.destinationAddress.Get ();
+        record.sourcePort = t.sourcePort;
+        record.destinationPort = t.destinationPort;
+        record.protocol = t.protocol;
+        record.txPackets = i->second.txPackets;
+        record.txBytes = i->second.txBytes;
+        record.rxPackets = i->second.rxPackets;
+        record.rxBytes = i->second.rxBytes;
+        record.lostPackets = i->second.lostPackets;
+        record.timeFirstTx = i->second.timeFirstTxPacket.GetNanoSeconds ();
+        record.timeLastTx = i->second.timeLastTxPacket.GetNanoSeconds ();
+        record.timeFirstRx = i->second.timeFirstRxPacket.GetNanoSeconds ();
+        record.timeLastRx = i->second.timeLastRxPacket.GetNanoSeconds ();
+        record.delaySum = i->second.delaySum.GetNanoSeconds ();
+        record.jitterSum = i->second.jitterSum.GetNanoSeconds ();
+        records.push_back (record);
+      }
+    } else {
+      records = probe.GetRecords ();
+    }
+    //One file per scenario, protocol, seed and nSinks: <scenario>-<protocol>-s<seed>r<run>-k<nSinks>.flows
+    ostringstream runName;
+    runName << tr_name << "-" << pName << "-s" << RngSeedManager::GetSeed () << "r" << RngSeedManager::GetRun ()
+            << "-k" << m_nSinks;
+    ostringstream flowLabel;
+    flowLabel << tr_name << "/" << pName << "/s" << RngSeedManager::GetSeed () << "r" << RngSeedManager::GetRun ()
+              << "/k" << m_nSinks;
+    ofstream flowFile ((runName.str () + ".flows").c_str (), ios::binary);
+    FlowExportWriter flowExport (flowFile);
+    flowExport.WriteHeader (flowLabel.str (), records.size ());
+    //tx and rx packets per building of the receiver, -1 for the base station
+    map<int32_t, pair<uint64_t, uint64_t> > byBuilding;
+    for (size_t i = 0; i < records.size (); i++) {
+      FlowRecord &r = records[i];
+      const NodeInfo *from = nodeIndex.Find (Ipv4Address (r.source));
+      const NodeInfo *to = nodeIndex.Find (Ipv4Address (r.destination));
+      r.sourceNode = from != 0 ? (int32_t)from->node : -1;
+      r.sourceBuilding = from != 0 ? from->building : -1;
+      r.destinationNode = to != 0 ? (int32_t)to->node : -1;
+      r.destinationBuilding = to != 0 ? to->building : -1;
+      flowExport.Write (r);
+      cout << "Flow:               " << " (" << Ipv4Address (r.source) << " -> " << Ipv4Address (r.destination) << ")\n";
+      cout << "  From:             " << nodeIndex.Describe (Ipv4Address (r.source)) << "\n";
+      cout << "  To:               " << nodeIndex.Describe (Ipv4Address (r.destination)) << "\n";
+      if (to != 0) {
+        byBuilding[to->building].first += r.txPackets;
+        byBuilding[to->building].second += r.rxPackets;
+      }
+      cout << "  Tx Packets:       " << r.txPackets << "\n";
+      cout << "  Tx Bytes:         " << r.txBytes << "\n";
+      cout << "  Rx Packets:       " << r.rxPackets << "\n";
+      cout << "  Rx Bytes:         " << r.rxBytes << "\n";
+      cout << "  Packet Loss:      " << r.txPackets - r.rxPackets << "\n";
+      if (r.rxPackets > 0) {
+        Time delay = NanoSeconds (r.delaySum / (int64_t)r.rxPackets);
+        Time jitter = NanoSeconds (r.jitterSum / (int64_t)r.rxPackets);
+        //Goodput over the time the flow was active
+        double active = (r.timeLastRx - r.timeFirstTx) / 1e9;
+        cout << "  Goodput:          " << (active > 0 ? r.rxBytes * 8 / active / 1000 : 0) << " kbps\n";
+        cout << "  Mean Delay:       " << delay.As(Time::S) << "\n";
+        if (m_flowmonMode == "all" || m_flowSample <= 1) {
+          cout << "  Jitter:           " << jitter.As(Time::S) << "\n";
+        } else {
+          cout << "  Jitter:           n/a (sampled)\n";
+        }
       }
-      cout << "  Mean Delay:       " << delay.As(Time::S) << "\n";
-      cout << "  Jitter:           " << jitter.As(Time::S) << "\n";
     }
+    //Building,protocol,building (0 for the base station),tx,rx
+    for (map<int32_t, pair<uint64_t, uint64_t> >::const_iterator b = byBuilding.begin (); b != byBuilding.end (); ++b) {
+      cout << "Building," << pName << "," << b->first + 1 << "," << b->second.first << "," << b->second.second << "\n";
+    }
+    PacketPool::Default ().Print (cout);
+    m_latency.Print (cout, pName);
+    if (!m_histFile.empty ()) {
+      ostringstream label;
+      label << tr_name << "/" << pName << "/k" << m_nSinks;
+      ofstream hist ((m_histFile + "." + pName + m_shard).c_str (), ios::binary);
+      m_latency.Write (hist, label.str ());
+    }
+    if (m_flowHistograms) {
+      m_latency.Write (flowFile, flowLabel.str ());
+    }
+    flowFile.close ();
+    runStats.Print (cout, m_delivered);
+    //RESULT,protocol,nSinks,throughput kbps over the traffic time,delivery ratio,sent,delivered
+    uint64_t sent = 0;
+    for (size_t i = 0; i < sources.size (); i++) {
+      sent += sources[i]->GetSent ();
+    }
+    cout << "RESULT," << pName << "," << m_nSinks << ","
+         << m_deliveredBytes * 8.0 / 1000 / trafficTime.GetSeconds () << ","
+         << (sent > 0 ? (double)m_delivered / sent : 0) << "," << sent << "," << m_delivered << "\n";
+  };
+
+  m_delivered = 0;
+  m_deliveredBytes = 0;
+  runStats.Start ();
+  bool ok = true;
+  if (m_sinksList.empty ()) {
+    if (m_converge) {
+      //The earlier stop wins over the one finish () schedules
+      convergence.Start (adhocNodes, [&] () {
+                           converged ();
+                           startFlows ();
+                           Simulator::Stop (trafficTime);
+                         });
+    } else {
+      startFlows ();
+    }
+    finish ();
+  } else {
+    //The routing warm-up does not depend on nSinks: simulate it once, then
+    //fork one branch per nSinks value that installs its own flows
+    if (m_converge) {
+      convergence.Start (adhocNodes, [&] () {
+                           converged ();
+                           Simulator::Stop ();
+                         });
+    } else {
+      Simulator::Stop (trafficStart);
+    }
+    Simulator::Run ();
+    ok = ForkRuns (m_sinksList, [&] (int k) {
+                     m_nSinks = k;
+                     m_log.SetSinks (k);
+                     SetShard (m_shard + ShardSuffix (k, ".k"));
+                     m_log.SetPath (CSVfileName + m_shard);
+                     cout << "Warm start: nSinks " << k << "\n";
+                     startFlows ();
+                     finish ();
+                     Simulator::Destroy ();
+                   }, CSVfileName + m_shard, ".k");
   }
-  flowmon.SerializeToXmlFile ((tr_name + ".flowmon").c_str(), false, false);
   Simulator::Destroy ();
+  PacketPool::Default ().Clear ();
+  return ok;
 }
 
@@ -0,0 +1,60 @@
+#ifndef COLLECTOR_SINK_H
+#define COLLECTOR_SINK_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+namespace ns3 {
+
+//Receiver for many-to-one traffic that never queues a packet. It counts
+//UDP datagrams for its port from the LocalDeliver trace of the node's
+//Ipv4L3Protocol, before the UDP layer, so there is no socket buffer, no
+//Recv and no Address per packet. A socket is still bound to the port with
+//RcvBufSize 0: UDP hands it every datagram, which it drops straight away,
+//instead of answering each one with an ICMP port unreachable.
+class CollectorSink
+{
+public:
+  CollectorSink () : m_port (0), m_packets (0), m_bytes (0) {}
+
+  //Called with every counted packet (UDP header still on) and its payload size
+  void SetCallback (Callback<void, Ptr<const Packet>, uint32_t> rx) { m_rx = rx; }
+
+  void Install (Ptr<Node> node, uint16_t port) {
+    m_port = port;
+    m_socket = Socket::CreateSocket (node, UdpSocketFactory::GetTypeId ());
+    m_socket->SetAttribute ("RcvBufSize", UintegerValue (0));
+    m_socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), port));
+    node->GetObject<Ipv4L3Protocol> ()->TraceConnectWithoutContext ("LocalDeliver", MakeCallback (&CollectorSink::Deliver, this));
+  }
+
+  uint64_t GetPackets () const { return m_packets; }
+  uint64_t GetBytes () const { return m_bytes; }
+
+private:
+  void Deliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface) {
+    //UDP header: source port, destination port, length, checksum
+    uint8_t udp[4];
+    if (header.GetProtocol () != UdpL4Protocol::PROT_NUMBER || packet->CopyData (udp, 4) != 4
+        || ((udp[2] << 8) | udp[3]) != m_port) {
+      return;
+    }
+    uint32_t payload = packet->GetSize () - 8;
+    m_packets++;
+    m_bytes += payload;
+    if (!m_rx.IsNull ()) {
+      m_rx (packet, payload);
+    }
+  }
+
+  uint16_t m_port;
+  Ptr<Socket> m_socket;
+  uint64_t m_packets;
+  uint64_t m_bytes;
+  Callback<void, Ptr<const Packet>, uint32_t> m_rx;
+};
+
+} // namespace ns3
+
+#endif /* COLLECTOR_SINK_H */
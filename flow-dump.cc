@@ -0,0 +1,44 @@
+#include <iostream>
+#include "flow-export.h"
+
+using namespace std;
+
+//Prints the flow records of FLW2 and FLW1 files (see flow-export.h) as CSV, one
+//row per flow tagged with the file label, and the percentiles of any
+//histograms stored after them
+int main (int argc, char *argv[]) {
+  if (argc < 2) {
+    cerr << "usage: flow-dump <file>...\n";
+    return 1;
+  }
+  cout << "Label,";
+  FlowExportReader::WriteCsvHeader (cout);
+  vector<pair<string, LatencyHistogram> > histograms;
+  for (int a = 1; a < argc; a++) {
+    FlowExportReader reader;
+    if (!reader.Open (argv[a])) {
+      cerr << "cannot read " << argv[a] << "\n";
+      return 1;
+    }
+    FlowRecord r;
+    while (reader.Next (r)) {
+      cout << reader.GetLabel () << ",";
+      FlowExportReader::WriteCsv (cout, r);
+    }
+    LatencyHistogram h;
+    string label;
+    while (reader.NextHistogram (h, label)) {
+      histograms.push_back (make_pair (label, h));
+    }
+  }
+  if (!histograms.empty ()) {
+    cout << "\nLabel,Count,P50Ms,P90Ms,P99Ms,P999Ms,MaxMs\n";
+    for (size_t i = 0; i < histograms.size (); i++) {
+      const LatencyHistogram &h = histograms[i].second;
+      cout << histograms[i].first << "," << h.GetCount () << "," << h.GetPercentile (50) / 1e6 << ","
+           << h.GetPercentile (90) / 1e6 << "," << h.GetPercentile (99) / 1e6 << ","
+           << h.GetPercentile (99.9) / 1e6 << "," << h.GetMax () / 1e6 << "\n";
+    }
+  }
+  return 0;
+}
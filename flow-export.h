@@ -0,0 +1,233 @@
+#ifndef FLOW_EXPORT_H
+#define FLOW_EXPORT_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "latency-histogram.h"
+
+//Per-flow flow monitor statistics, one fixed-size record per flow.
+//Addresses are IPv4 in host order, times in ns. Nodes are ns-3 node ids
+//and buildings 0-based campus building indices; -1 when unknown or, for
+//buildings, outside any building.
+struct FlowRecord
+{
+  uint32_t flowId;
+  uint32_t source;
+  uint32_t destination;
+  uint16_t sourcePort;
+  uint16_t destinationPort;
+  uint8_t protocol;
+  uint64_t txPackets;
+  uint64_t txBytes;
+  uint64_t rxPackets;
+  uint64_t rxBytes;
+  uint64_t lostPackets;
+  int64_t timeFirstTx;
+  int64_t timeLastTx;
+  int64_t timeFirstRx;
+  int64_t timeLastRx;
+  int64_t delaySum;
+  int64_t jitterSum;
+  int32_t sourceNode;
+  int32_t sourceBuilding;
+  int32_t destinationNode;
+  int32_t destinationBuilding;
+};
+
+//Compact replacement for FlowMonitor::SerializeToXmlFile. A file is
+//  char magic[4] = "FLW2", uint32_t labelLength, char label[labelLength],
+//  uint32_t records, records x 121 bytes (the FlowRecord fields in order,
+//  no padding), then optionally HDR1 histogram blocks until the end
+//all little-endian as written by the host. FLW1 files have 105-byte
+//records without the node and building fields. Records are written as they
+//are handed over; nothing is buffered.
+class FlowExportWriter
+{
+public:
+  FlowExportWriter (std::ostream &out) : m_out (out) {}
+
+  void WriteHeader (const std::string &label, uint32_t records) {
+    uint32_t length = label.size ();
+    m_out.write ("FLW2", 4);
+    Put (length);
+    m_out.write (label.data (), length);
+    Put (records);
+  }
+
+  void Write (const FlowRecord &r) {
+    Put (r.flowId);
+    Put (r.source);
+    Put (r.destination);
+    Put (r.sourcePort);
+    Put (r.destinationPort);
+    Put (r.protocol);
+    Put (r.txPackets);
+    Put (r.txBytes);
+    Put (r.rxPackets);
+    Put (r.rxBytes);
+    Put (r.lostPackets);
+    Put (r.timeFirstTx);
+    Put (r.timeLastTx);
+    Put (r.timeFirstRx);
+    Put (r.timeLastRx);
+    Put (r.delaySum);
+    Put (r.jitterSum);
+    Put (r.sourceNode);
+    Put (r.sourceBuilding);
+    Put (r.destinationNode);
+    Put (r.destinationBuilding);
+  }
+
+  std::ostream &GetStream () { return m_out; }
+
+private:
+  template <class T>
+  void Put (T value) { m_out.write ((const char *)&value, sizeof (T)); }
+
+  std::ostream &m_out;
+};
+
+//Reads a FLW2 (or FLW1) file in one go and decodes the records from memory
+class FlowExportReader
+{
+public:
+  //False if the file is missing or not a flow export file
+  bool Open (const std::string &path) {
+    std::ifstream in (path.c_str (), std::ios::binary);
+    if (!in) {
+      return false;
+    }
+    std::ostringstream data;
+    data << in.rdbuf ();
+    m_data = data.str ();
+    m_pos = 0;
+    m_next = 0;
+    uint32_t length = 0;
+    if (m_data.compare (0, 4, "FLW2") == 0) {
+      m_version = 2;
+    } else if (m_data.compare (0, 4, "FLW1") == 0) {
+      m_version = 1;
+    } else {
+      return false;
+    }
+    m_pos = 4;
+    if (!Get (length) || m_pos + length > m_data.size ()) {
+      return false;
+    }
+    m_label = m_data.substr (m_pos, length);
+    m_pos += length;
+    size_t size = m_version == 1 ? RECORD_SIZE_V1 : RECORD_SIZE;
+    return Get (m_records) && m_pos + (uint64_t)m_records * size <= m_data.size ();
+  }
+
+  //<scenario>/<protocol>/s<RngSeed>r<RngRun>/k<nSinks>
+  const std::string &GetLabel () const { return m_label; }
+  uint32_t GetNRecords () const { return m_records; }
+
+  //False after the last record
+  bool Next (FlowRecord &r) {
+    if (m_next >= m_records) {
+      return false;
+    }
+    m_next++;
+    Get (r.flowId);
+    Get (r.source);
+    Get (r.destination);
+    Get (r.sourcePort);
+    Get (r.destinationPort);
+    Get (r.protocol);
+    Get (r.txPackets);
+    Get (r.txBytes);
+    Get (r.rxPackets);
+    Get (r.rxBytes);
+    Get (r.lostPackets);
+    Get (r.timeFirstTx);
+    Get (r.timeLastTx);
+    Get (r.timeFirstRx);
+    Get (r.timeLastRx);
+    Get (r.delaySum);
+    if (m_version == 1) {
+      r.sourceNode = r.sourceBuilding = r.destinationNode = r.destinationBuilding = -1;
+      return Get (r.jitterSum);
+    }
+    Get (r.jitterSum);
+    Get (r.sourceNode);
+    Get (r.sourceBuilding);
+    Get (r.destinationNode);
+    return Get (r.destinationBuilding);
+  }
+
+  //Histogram blocks after the records; call once Next returned false
+  bool NextHistogram (LatencyHistogram &histogram, std::string &label) {
+    if (m_next < m_records || m_pos >= m_data.size ()) {
+      return false;
+    }
+    //Decoded in place; a copy of the rest of the file per block would make
+    //reading a file with many flows quadratic
+    MemoryBuffer buffer (m_data.data () + m_pos, m_data.size () - m_pos);
+    std::istream in (&buffer);
+    bool ok = histogram.Read (in, label);
+    m_pos = ok ? m_pos + buffer.GetConsumed () : m_data.size ();
+    return ok;
+  }
+
+  static void WriteCsvHeader (std::ostream &out) {
+    out << "FlowId,Source,Destination,SourcePort,DestinationPort,Protocol,TxPackets,TxBytes,"
+        << "RxPackets,RxBytes,LostPackets,TimeFirstTxNs,TimeLastTxNs,TimeFirstRxNs,TimeLastRxNs,"
+        << "DelaySumNs,JitterSumNs,SourceNode,SourceBuilding,DestinationNode,DestinationBuilding\n";
+  }
+
+  static void WriteCsv (std::ostream &out, const FlowRecord &r) {
+    out << r.flowId << "," << FormatAddress (r.source) << "," << FormatAddress (r.destination) << ","
+        << r.sourcePort << "," << r.destinationPort << "," << (unsigned)r.protocol << ","
+        << r.txPackets << "," << r.txBytes << "," << r.rxPackets << "," << r.rxBytes << ","
+        << r.lostPackets << "," << r.timeFirstTx << "," << r.timeLastTx << ","
+        << r.timeFirstRx << "," << r.timeLastRx << "," << r.delaySum << "," << r.jitterSum << ","
+        << r.sourceNode << "," << r.sourceBuilding << "," << r.destinationNode << "," << r.destinationBuilding << "\n";
+  }
+
+  static std::string FormatAddress (uint32_t a) {
+    std::ostringstream s;
+    s << (a >> 24) << "." << ((a >> 16) & 0xff) << "." << ((a >> 8) & 0xff) << "." << (a & 0xff);
+    return s.str ();
+  }
+
+private:
+  static const size_t RECORD_SIZE_V1 = 3 * 4 + 2 * 2 + 1 + 5 * 8 + 6 * 8;
+  static const size_t RECORD_SIZE = RECORD_SIZE_V1 + 4 * 4;
+
+  //Read-only stream over a range of m_data
+  class MemoryBuffer : public std::streambuf
+  {
+  public:
+    MemoryBuffer (const char *data, size_t size) {
+      char *begin = const_cast<char *> (data);
+      setg (begin, begin, begin + size);
+    }
+    size_t GetConsumed () const { return gptr () - eback (); }
+  };
+
+  template <class T>
+  bool Get (T &value) {
+    if (m_pos + sizeof (T) > m_data.size ()) {
+      return false;
+    }
+    std::memcpy (&value, m_data.data () + m_pos, sizeof (T));
+    m_pos += sizeof (T);
+    return true;
+  }
+
+  std::string m_data;
+  size_t m_pos;
+  std::string m_label;
+  uint32_t m_records;
+  uint32_t m_next;
+  int m_version;
+};
+
+#endif /* FLOW_EXPORT_H */
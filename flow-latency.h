@@ -0,0 +1,131 @@
+#ifndef FLOW_LATENCY_H
+#define FLOW_LATENCY_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "flow-time-tag.h"
+#include "latency-histogram.h"
+
+namespace ns3 {
+
+//Delay and jitter histograms and goodput of every flow, fed from the
+//receive path with the FlowTimeTag of timestamping sources. Jitter is the
+//difference between the delays of consecutive packets of a flow (RFC 3550
+//without the smoothing). Goodput is the bytes received over the time from
+//the first send to the last receive of the flow. Print writes one line per
+//flow and one for all of them:
+//  Latency,label,flow|all,rx_packets,delay p50,p90,p99,p999,max (ms),
+//  jitter p50,p99 (ms),goodput_kbps
+class FlowLatency
+{
+public:
+  void Start (uint32_t flows) { m_flows.assign (flows, Flow ()); }
+
+  //Call before the packet is recycled; untagged packets are ignored
+  void Rx (Ptr<const Packet> packet) { Rx (packet, packet->GetSize ()); }
+
+  //bytes: payload size, for packets that still carry lower layer headers
+  void Rx (Ptr<const Packet> packet, uint32_t bytes) {
+    FlowTimeTag tag;
+    if (!packet->PeekPacketTag (tag) || tag.GetFlow () >= m_flows.size ()) {
+      return;
+    }
+    Flow &flow = m_flows[tag.GetFlow ()];
+    int64_t delay = (Simulator::Now () - tag.GetTxTime ()).GetNanoSeconds ();
+    flow.delay.Record (delay);
+    if (flow.rxPackets > 0) {
+      flow.jitter.Record (std::llabs (delay - flow.lastDelay));
+      flow.firstTx = std::min (flow.firstTx, tag.GetTxTime ());
+    } else {
+      flow.firstTx = tag.GetTxTime ();
+    }
+    flow.lastDelay = delay;
+    flow.lastRx = Simulator::Now ();
+    flow.rxPackets++;
+    flow.rxBytes += bytes;
+  }
+
+  uint32_t GetN () const { return m_flows.size (); }
+  const LatencyHistogram &GetDelay (uint32_t flow) const { return m_flows[flow].delay; }
+  const LatencyHistogram &GetJitter (uint32_t flow) const { return m_flows[flow].jitter; }
+
+  //Received bits per second of the active time of flow
+  double GetGoodput (uint32_t flow) const {
+    const Flow &f = m_flows[flow];
+    double active = (f.lastRx - f.firstTx).GetSeconds ();
+    return active > 0 ? f.rxBytes * 8 / active : 0;
+  }
+
+  void Print (std::ostream &os, const std::string &label) const {
+    Flow all = GetAll ();
+    for (uint32_t f = 0; f < m_flows.size (); f++) {
+      PrintFlow (os, label, std::to_string (f), m_flows[f]);
+    }
+    PrintFlow (os, label, "all", all);
+  }
+
+  //Appends the histograms as HDR1 blocks labelled label/<flow>/delay and
+  //label/<flow>/jitter, flow being the index or "all"
+  void Write (std::ostream &out, const std::string &label) const {
+    Flow all = GetAll ();
+    for (uint32_t f = 0; f < m_flows.size (); f++) {
+      m_flows[f].delay.Write (out, label + "/" + std::to_string (f) + "/delay");
+      m_flows[f].jitter.Write (out, label + "/" + std::to_string (f) + "/jitter");
+    }
+    all.delay.Write (out, label + "/all/delay");
+    all.jitter.Write (out, label + "/all/jitter");
+  }
+
+private:
+  struct Flow
+  {
+    Flow () : lastDelay (0), rxPackets (0), rxBytes (0) {}
+    LatencyHistogram delay;
+    LatencyHistogram jitter;
+    int64_t lastDelay;
+    Time firstTx;
+    Time lastRx;
+    uint64_t rxPackets;
+    uint64_t rxBytes;
+  };
+
+  //All flows merged; the active time spans the first send to the last receive
+  Flow GetAll () const {
+    Flow all;
+    for (uint32_t f = 0; f < m_flows.size (); f++) {
+      const Flow &flow = m_flows[f];
+      if (flow.rxPackets == 0) {
+        continue;
+      }
+      all.delay.Merge (flow.delay);
+      all.jitter.Merge (flow.jitter);
+      all.firstTx = all.rxPackets > 0 ? std::min (all.firstTx, flow.firstTx) : flow.firstTx;
+      all.lastRx = std::max (all.lastRx, flow.lastRx);
+      all.rxPackets += flow.rxPackets;
+      all.rxBytes += flow.rxBytes;
+    }
+    return all;
+  }
+
+  static void PrintFlow (std::ostream &os, const std::string &label, const std::string &name, const Flow &f) {
+    double active = (f.lastRx - f.firstTx).GetSeconds ();
+    os << "Latency," << label << "," << name << "," << f.rxPackets << ","
+       << f.delay.GetPercentile (50) / 1e6 << "," << f.delay.GetPercentile (90) / 1e6 << ","
+       << f.delay.GetPercentile (99) / 1e6 << "," << f.delay.GetPercentile (99.9) / 1e6 << ","
+       << f.delay.GetMax () / 1e6 << ","
+       << f.jitter.GetPercentile (50) / 1e6 << "," << f.jitter.GetPercentile (99) / 1e6 << ","
+       << (active > 0 ? f.rxBytes * 8 / active / 1000 : 0) << "\n";
+  }
+
+  std::vector<Flow> m_flows;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_LATENCY_H */
@@ -0,0 +1,225 @@
+#ifndef FLOW_PROBE_H
+#define FLOW_PROBE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "flow-export.h"
+
+namespace ns3 {
+
+//Index of the sampled packet's flow and its send time
+class FlowProbeTag : public Tag
+{
+public:
+  FlowProbeTag () : m_flow (0), m_txTime (0) {}
+  FlowProbeTag (uint32_t flow, Time txTime) : m_flow (flow), m_txTime (txTime.GetNanoSeconds ()) {}
+
+  static TypeId GetTypeId (void) {
+    static TypeId tid = TypeId ("ns3::FlowProbeTag")
+      .SetParent<Tag> ()
+      .SetGroupName ("Stats")
+      .AddConstructor<FlowProbeTag> ();
+    return tid;
+  }
+  virtual TypeId GetInstanceTypeId (void) const { return GetTypeId (); }
+  virtual uint32_t GetSerializedSize (void) const { return 12; }
+  virtual void Serialize (TagBuffer i) const {
+    i.WriteU32 (m_flow);
+    i.WriteU64 (m_txTime);
+  }
+  virtual void Deserialize (TagBuffer i) {
+    m_flow = i.ReadU32 ();
+    m_txTime = i.ReadU64 ();
+  }
+  virtual void Print (std::ostream &os) const {
+    os << "flow=" << m_flow << " tx=" << m_txTime << "ns";
+  }
+
+  uint32_t GetFlow () const { return m_flow; }
+  Time GetTxTime () const { return NanoSeconds (m_txTime); }
+
+private:
+  uint32_t m_flow;
+  int64_t m_txTime;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (FlowProbeTag);
+
+//Lightweight stand-in for FlowMonitor that only follows the flows it is
+//told to. Packets leaving their source are filtered by IP protocol,
+//port and address before any flow state exists, so routing control
+//traffic costs one header check and is never tracked. Of the packets that
+//pass, every packet counts towards tx, but only 1 in sampling gets a tag
+//and is followed to its receiver; received packets, bytes and delay are
+//scaled up from that sample, and whatever was sent and not received counts
+//as lost. Jitter needs consecutive packets, so it is only reported (and
+//jitterSum only non-zero) with sampling 1, which follows every packet and
+//gives exact counts like FlowMonitor.
+class DataFlowProbe
+{
+public:
+  DataFlowProbe () : m_protocol (0), m_sampling (1), m_matched (0), m_sampled (0) {}
+
+  //0 accepts any protocol; 6 (TCP) and 17 (UDP) also allow port filters
+  void SetProtocol (uint8_t protocol) { m_protocol = protocol; }
+  //Matches the source or destination port; none set accepts every port
+  void AddPort (uint16_t port) { m_ports.insert (port); }
+  //Matches the source or destination address; none set accepts every address
+  void AddAddress (Ipv4Address address) { m_addresses.insert (address.Get ()); }
+  void SetSampling (uint32_t sampling) { m_sampling = std::max (sampling, 1u); }
+  bool HasJitter () const { return m_sampling == 1; }
+
+  void Install (NodeContainer nodes) {
+    for (uint32_t n = 0; n < nodes.GetN (); n++) {
+      Ptr<Ipv4L3Protocol> ipv4 = nodes.Get (n)->GetObject<Ipv4L3Protocol> ();
+      NS_ABORT_MSG_IF (ipv4 == 0, "DataFlowProbe needs the internet stack installed first");
+      ipv4->TraceConnectWithoutContext ("SendOutgoing", MakeCallback (&DataFlowProbe::Send, this));
+      ipv4->TraceConnectWithoutContext ("LocalDeliver", MakeCallback (&DataFlowProbe::Deliver, this));
+    }
+  }
+
+  //Estimated statistics of every flow, in FlowRecord form
+  std::vector<FlowRecord> GetRecords () const {
+    std::vector<FlowRecord> records;
+    for (size_t f = 0; f < m_flows.size (); f++) {
+      const Flow &flow = m_flows[f];
+      double scale = flow.sampledTx > 0 ? (double)flow.txPackets / flow.sampledTx : 0;
+      FlowRecord r = flow.record;
+      r.flowId = f + 1;
+      r.rxPackets = std::min<uint64_t> (r.txPackets, (uint64_t)std::llround (flow.sampledRx * scale));
+      r.rxBytes = std::llround (flow.sampledRxBytes * scale);
+      r.lostPackets = r.txPackets - r.rxPackets;
+      r.delaySum = std::llround (flow.delaySum * scale);
+      r.jitterSum = HasJitter () ? std::llround (flow.jitterSum) : 0;
+      records.push_back (r);
+    }
+    return records;
+  }
+
+  //Packets that passed the filter and packets followed
+  uint64_t GetMatched () const { return m_matched; }
+  uint64_t GetSampled () const { return m_sampled; }
+
+private:
+  //Addresses in a, ports and protocol in b
+  struct FlowKey
+  {
+    uint64_t a;
+    uint64_t b;
+    bool operator== (const FlowKey &other) const { return a == other.a && b == other.b; }
+  };
+  struct FlowKeyHash
+  {
+    size_t operator() (const FlowKey &key) const { return key.a * 0x9e3779b97f4a7c15ULL ^ key.b; }
+  };
+
+  struct Flow
+  {
+    FlowRecord record;
+    uint64_t sampledTx;
+    uint64_t sampledRx;
+    uint64_t sampledRxBytes;
+    double delaySum;
+    double jitterSum;
+    int64_t lastDelay;
+  };
+
+  bool Accept (const Ipv4Header &header, Ptr<const Packet> packet, uint16_t &sourcePort, uint16_t &destinationPort) const {
+    uint8_t protocol = header.GetProtocol ();
+    if (m_protocol != 0 && protocol != m_protocol) {
+      return false;
+    }
+    if (!m_addresses.empty () && !m_addresses.count (header.GetSource ().Get ())
+        && !m_addresses.count (header.GetDestination ().Get ())) {
+      return false;
+    }
+    sourcePort = destinationPort = 0;
+    if (protocol == UdpL4Protocol::PROT_NUMBER || protocol == TcpL4Protocol::PROT_NUMBER) {
+      //Both headers start with the two ports
+      uint8_t ports[4];
+      if (packet->CopyData (ports, 4) == 4) {
+        sourcePort = (ports[0] << 8) | ports[1];
+        destinationPort = (ports[2] << 8) | ports[3];
+      }
+    }
+    return m_ports.empty () || m_ports.count (sourcePort) || m_ports.count (destinationPort);
+  }
+
+  void Send (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface) {
+    uint16_t sourcePort, destinationPort;
+    if (!Accept (header, packet, sourcePort, destinationPort)) {
+      return;
+    }
+    m_matched++;
+    FlowKey key;
+    key.a = ((uint64_t)header.GetSource ().Get () << 32) | header.GetDestination ().Get ();
+    key.b = ((uint64_t)sourcePort << 24) | ((uint64_t)destinationPort << 8) | header.GetProtocol ();
+    std::unordered_map<FlowKey, uint32_t, FlowKeyHash>::iterator i = m_index.find (key);
+    if (i == m_index.end ()) {
+      Flow flow = Flow ();
+      flow.record.source = header.GetSource ().Get ();
+      flow.record.destination = header.GetDestination ().Get ();
+      flow.record.sourcePort = sourcePort;
+      flow.record.destinationPort = destinationPort;
+      flow.record.protocol = header.GetProtocol ();
+      flow.record.sourceNode = flow.record.sourceBuilding = -1;
+      flow.record.destinationNode = flow.record.destinationBuilding = -1;
+      flow.record.timeFirstTx = Simulator::Now ().GetNanoSeconds ();
+      i = m_index.insert (std::make_pair (key, (uint32_t)m_flows.size ())).first;
+      m_flows.push_back (flow);
+    }
+    Flow &flow = m_flows[i->second];
+    if (flow.record.txPackets % m_sampling == 0) {
+      FlowProbeTag tag;
+      if (!packet->PeekPacketTag (tag)) {
+        packet->AddPacketTag (FlowProbeTag (i->second, Simulator::Now ()));
+        flow.sampledTx++;
+        m_sampled++;
+      }
+    }
+    flow.record.txPackets++;
+    flow.record.txBytes += packet->GetSize () + header.GetSerializedSize ();
+    flow.record.timeLastTx = Simulator::Now ().GetNanoSeconds ();
+  }
+
+  void Deliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface) {
+    FlowProbeTag tag;
+    if (!packet->PeekPacketTag (tag) || tag.GetFlow () >= m_flows.size ()) {
+      return;
+    }
+    Flow &flow = m_flows[tag.GetFlow ()];
+    int64_t now = Simulator::Now ().GetNanoSeconds ();
+    int64_t delay = now - tag.GetTxTime ().GetNanoSeconds ();
+    if (flow.sampledRx > 0) {
+      //Packets sampling apart when sampling > 1; GetRecords drops it then
+      flow.jitterSum += std::llabs (delay - flow.lastDelay);
+    } else {
+      flow.record.timeFirstRx = now;
+    }
+    flow.lastDelay = delay;
+    flow.delaySum += delay;
+    flow.sampledRx++;
+    flow.sampledRxBytes += packet->GetSize () + header.GetSerializedSize ();
+    flow.record.timeLastRx = now;
+  }
+
+  uint8_t m_protocol;
+  std::unordered_set<uint16_t> m_ports;
+  std::unordered_set<uint32_t> m_addresses;
+  uint32_t m_sampling;
+  std::unordered_map<FlowKey, uint32_t, FlowKeyHash> m_index;
+  std::vector<Flow> m_flows;
+  uint64_t m_matched;
+  uint64_t m_sampled;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_PROBE_H */
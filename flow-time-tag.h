@@ -0,0 +1,49 @@
+#ifndef FLOW_TIME_TAG_H
+#define FLOW_TIME_TAG_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+namespace ns3 {
+
+//Flow index and send time, added by a TrafficSource with Timestamp set
+class FlowTimeTag : public Tag
+{
+public:
+  FlowTimeTag () : m_flow (0), m_txTime (0) {}
+  FlowTimeTag (uint32_t flow, Time txTime) : m_flow (flow), m_txTime (txTime.GetNanoSeconds ()) {}
+
+  static TypeId GetTypeId (void) {
+    static TypeId tid = TypeId ("ns3::FlowTimeTag")
+      .SetParent<Tag> ()
+      .SetGroupName ("Stats")
+      .AddConstructor<FlowTimeTag> ();
+    return tid;
+  }
+  virtual TypeId GetInstanceTypeId (void) const { return GetTypeId (); }
+  virtual uint32_t GetSerializedSize (void) const { return 12; }
+  virtual void Serialize (TagBuffer i) const {
+    i.WriteU32 (m_flow);
+    i.WriteU64 (m_txTime);
+  }
+  virtual void Deserialize (TagBuffer i) {
+    m_flow = i.ReadU32 ();
+    m_txTime = i.ReadU64 ();
+  }
+  virtual void Print (std::ostream &os) const {
+    os << "flow=" << m_flow << " tx=" << m_txTime << "ns";
+  }
+
+  uint32_t GetFlow () const { return m_flow; }
+  Time GetTxTime () const { return NanoSeconds (m_txTime); }
+
+private:
+  uint32_t m_flow;
+  int64_t m_txTime;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (FlowTimeTag);
+
+} // namespace ns3
+
+#endif /* FLOW_TIME_TAG_H */
@@ -0,0 +1,208 @@
+#ifndef FLOW_WINDOW_STATS_H
+#define FLOW_WINDOW_STATS_H
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "flow-time-tag.h"
+#include "traffic-source.h"
+
+namespace ns3 {
+
+//Per-flow tx/rx packets, bytes, loss and delay in fixed windows, written
+//as the run goes instead of from the flow monitor after it. Packets are
+//matched to flows by the FlowTimeTag of timestamping sources. A received
+//packet counts in the window it was sent in, so each flow keeps a ring of
+//the last slots windows; a window is written out, one line per flow with
+//traffic, once it drops off the ring, i.e. slots - 1 windows after it
+//ended. Packets still missing by then count as lost, and ones arriving
+//even later only as late. Memory is flows x slots whatever the run length.
+//
+//  Window,label,flow,source,source_building,sink,sink_building,start_s,
+//  tx_packets,tx_bytes,rx_packets,rx_bytes,lost,mean_delay_ms,max_delay_ms
+//source and sink are ns-3 node ids, buildings 0-based; -1 when not set
+//with SetEndpoints or, for buildings, outside any building.
+class FlowWindowStats
+{
+public:
+  FlowWindowStats () : m_window (Seconds (1)), m_slots (16), m_os (&std::cout), m_flows (0), m_current (0), m_late (0) {}
+
+  void SetWindow (Time window) { m_window = window; }
+  void SetSlots (uint32_t slots) { m_slots = std::max (slots, 1u); }
+  void SetStream (std::ostream *os) { m_os = os; }
+  void SetLabel (const std::string &label) { m_label = label; }
+
+  //Clears the counters of a previous run; the first window starts at origin
+  void Start (uint32_t flows, Time origin) {
+    m_ring.assign ((size_t)flows * m_slots, Slot ());
+    m_endpoints.assign (flows, Endpoints ());
+    m_flows = flows;
+    m_origin = origin;
+    m_current = 0;
+    m_late = 0;
+    m_event = Simulator::Schedule (origin + m_window - Simulator::Now (), &FlowWindowStats::Tick, this);
+  }
+
+  //Who is at both ends of flow, for its Window lines
+  void SetEndpoints (uint32_t flow, int32_t source, int32_t sourceBuilding, int32_t sink, int32_t sinkBuilding) {
+    if (flow < m_flows) {
+      Endpoints &e = m_endpoints[flow];
+      e.source = source;
+      e.sourceBuilding = sourceBuilding;
+      e.sink = sink;
+      e.sinkBuilding = sinkBuilding;
+    }
+  }
+
+  //Counts what source sends; it needs Timestamp set
+  void Watch (Ptr<TrafficSource> source) {
+    source->TraceConnectWithoutContext ("Tx", MakeCallback (&FlowWindowStats::Tx, this));
+  }
+
+  void Tx (Ptr<const Packet> packet) {
+    FlowTimeTag tag;
+    if (!packet->PeekPacketTag (tag) || tag.GetFlow () >= m_flows) {
+      return;
+    }
+    Advance ();
+    Slot *slot = Find (tag.GetFlow (), tag.GetTxTime ());
+    if (slot != 0) {
+      slot->txPackets++;
+      slot->txBytes += packet->GetSize ();
+    }
+  }
+
+  //Call before the packet is recycled; untagged packets are ignored
+  void Rx (Ptr<const Packet> packet) { Rx (packet, packet->GetSize ()); }
+
+  //bytes: payload size, for packets that still carry lower layer headers
+  void Rx (Ptr<const Packet> packet, uint32_t bytes) {
+    FlowTimeTag tag;
+    if (!packet->PeekPacketTag (tag) || tag.GetFlow () >= m_flows) {
+      return;
+    }
+    Advance ();
+    Slot *slot = Find (tag.GetFlow (), tag.GetTxTime ());
+    if (slot == 0) {
+      m_late++;
+      return;
+    }
+    int64_t delay = (Simulator::Now () - tag.GetTxTime ()).GetNanoSeconds ();
+    slot->rxPackets++;
+    slot->rxBytes += bytes;
+    slot->delaySum += delay;
+    slot->delayMax = std::max (slot->delayMax, delay);
+  }
+
+  //Writes the windows still on the ring and stops the window clock
+  void Flush () {
+    m_event.Cancel ();
+    int64_t first = std::max<int64_t> (0, m_current - m_slots + 1);
+    for (int64_t w = first; w <= m_current; w++) {
+      Close (w);
+    }
+  }
+
+  //Packets that arrived after their window was written out
+  uint64_t GetLate () const { return m_late; }
+
+private:
+  struct Slot
+  {
+    Slot () : window (-1), txPackets (0), txBytes (0), rxPackets (0), rxBytes (0), delaySum (0), delayMax (0) {}
+    int64_t window;
+    uint32_t txPackets;
+    uint64_t txBytes;
+    uint32_t rxPackets;
+    uint64_t rxBytes;
+    int64_t delaySum;
+    int64_t delayMax;
+  };
+
+  struct Endpoints
+  {
+    Endpoints () : source (-1), sourceBuilding (-1), sink (-1), sinkBuilding (-1) {}
+    int32_t source;
+    int32_t sourceBuilding;
+    int32_t sink;
+    int32_t sinkBuilding;
+  };
+
+  int64_t GetIndex (Time t) const {
+    return (t - m_origin).GetNanoSeconds () / m_window.GetNanoSeconds ();
+  }
+
+  //Slot of window GetIndex (t), 0 if it is not on the ring
+  Slot *Find (uint32_t flow, Time t) {
+    if (t < m_origin) {
+      return 0;
+    }
+    int64_t w = GetIndex (t);
+    if (w > m_current || w <= m_current - m_slots) {
+      return 0;
+    }
+    Slot &slot = m_ring[(size_t)flow * m_slots + w % m_slots];
+    if (slot.window != w) {
+      slot = Slot ();
+      slot.window = w;
+    }
+    return &slot;
+  }
+
+  void Close (int64_t w) {
+    double start = (m_origin + NanoSeconds (m_window.GetNanoSeconds () * w)).GetSeconds ();
+    for (uint32_t f = 0; f < m_flows; f++) {
+      Slot &slot = m_ring[(size_t)f * m_slots + w % m_slots];
+      if (slot.window == w && (slot.txPackets > 0 || slot.rxPackets > 0)) {
+        const Endpoints &e = m_endpoints[f];
+        *m_os << "Window," << m_label << "," << f << "," << e.source << "," << e.sourceBuilding << ","
+              << e.sink << "," << e.sinkBuilding << "," << start << ","
+              << slot.txPackets << "," << slot.txBytes << ","
+              << slot.rxPackets << "," << slot.rxBytes << ","
+              << (slot.txPackets > slot.rxPackets ? slot.txPackets - slot.rxPackets : 0) << ","
+              << (slot.rxPackets > 0 ? slot.delaySum / 1e6 / slot.rxPackets : 0) << ","
+              << slot.delayMax / 1e6 << "\n";
+      }
+      slot = Slot ();
+    }
+  }
+
+  //Moves the ring up to the current window, writing out what drops off.
+  //Packets at a window boundary may run before the Tick of that boundary.
+  void Advance () {
+    if (Simulator::Now () < m_origin) {
+      return;
+    }
+    int64_t now = GetIndex (Simulator::Now ());
+    while (m_current < now) {
+      m_current++;
+      if (m_current >= m_slots) {
+        Close (m_current - m_slots);
+      }
+    }
+  }
+
+  void Tick () {
+    Advance ();
+    m_event = Simulator::Schedule (m_origin + NanoSeconds (m_window.GetNanoSeconds () * (m_current + 1)) - Simulator::Now (), &FlowWindowStats::Tick, this);
+  }
+
+  Time m_window;
+  uint32_t m_slots;
+  std::ostream *m_os;
+  std::string m_label;
+  std::vector<Slot> m_ring;
+  std::vector<Endpoints> m_endpoints;
+  uint32_t m_flows;
+  Time m_origin;
+  int64_t m_current;
+  uint64_t m_late;
+  EventId m_event;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_WINDOW_STATS_H */
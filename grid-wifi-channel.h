@@ -0,0 +1,431 @@
+#ifndef GRID_WIFI_CHANNEL_H
+#define GRID_WIFI_CHANNEL_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "batch-loss.h"
+#include "cached-loss-model.h"
+#include "building-wall-loss-model.h"
+
+namespace ns3 {
+
+class GridWifiChannel;
+
+//YansWifiPhy that hands its transmissions to a GridWifiChannel.
+//YansWifiChannel::Send is not virtual, so the hook has to be on the PHY.
+class GridWifiPhy : public YansWifiPhy
+{
+public:
+  static TypeId GetTypeId (void);
+  void SetGridChannel (Ptr<GridWifiChannel> channel);
+  virtual void StartTx (Ptr<Packet> packet, WifiTxVector txVector, Time txDuration);
+
+private:
+  Ptr<GridWifiChannel> m_gridChannel;
+};
+
+//YansWifiChannel that only evaluates receivers inside the useful range of a
+//transmission. Node positions are kept in a uniform grid that is updated
+//from the mobility CourseChange traces, plus a periodic refresh of moving
+//nodes so that nodes walking between course changes are never missed.
+//Receivers whose power would be dropped by YansWifiChannel::Receive anyway
+//are not scheduled, so the PHYs see the same events as with the stock channel.
+//All receiver powers of one transmission are computed in a single pass,
+//then every receiver gets its own event in its own node's context.
+//With BatchLoss, Friis and Nakagami -> Friis chains (Friis possibly cached)
+//are evaluated for all receivers by one BatchLoss call instead of one
+//CalcRxPower each.
+class GridWifiChannel : public YansWifiChannel
+{
+public:
+  static TypeId GetTypeId (void);
+  GridWifiChannel ();
+
+  void SetPropagationLossModel (Ptr<PropagationLossModel> loss);
+  void SetPropagationDelayModel (Ptr<PropagationDelayModel> delay);
+  void AddGridPhy (Ptr<GridWifiPhy> phy);
+  void Send (Ptr<GridWifiPhy> sender, Ptr<const Packet> packet, double txPowerDbm, Time duration);
+  int64_t AssignStreams (int64_t stream);
+
+  //Range in meters past which txPowerDbm can not be received, or infinity
+  double GetRange (double txPowerDbm);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  struct Entry {
+    Ptr<GridWifiPhy> phy;
+    Ptr<MobilityModel> mobility;
+    Vector pos;
+    int64_t cell;
+    uint32_t slot;
+    bool moving;
+  };
+
+  static void Receive (Ptr<YansWifiPhy> phy, Ptr<Packet> packet, double rxPowerDbm, Time duration);
+  static bool IsPassiveLoss (Ptr<PropagationLossModel> model);
+  static void ScanLoss (Ptr<PropagationLossModel> model, Ptr<FriisPropagationLossModel> &friis, bool &passive);
+  static int64_t CellKey (int64_t ix, int64_t iy);
+  int64_t CellOf (const Vector &pos) const;
+  void Insert (uint32_t index);
+  void Remove (uint32_t index);
+  void Bind ();
+  void Refresh ();
+  void CourseChanged (Ptr<const MobilityModel> mobility);
+  void Collect (const Vector &pos, double range);
+
+  Ptr<PropagationLossModel> m_loss;
+  Ptr<PropagationDelayModel> m_delay;
+  Ptr<BatchLoss> m_batchLoss;
+  PositionBatch m_positions;
+  std::vector<double> m_rxPowers;
+  std::vector<Entry> m_entries;
+  std::unordered_map<int64_t, std::vector<uint32_t> > m_cells;
+  std::unordered_map<const MobilityModel *, uint32_t> m_byMobility;
+  std::vector<uint32_t> m_candidates;
+  uint32_t m_bound;
+  bool m_useBatchLoss;
+  double m_cellSize;
+  double m_maxRange;
+  double m_maxSpeed;
+  double m_minRxDbm;
+  double m_rangeTxPowerDbm;
+  double m_range;
+  Time m_refresh;
+  Time m_nextRefresh;
+};
+
+//YansWifiPhyHelper that builds GridWifiPhy objects attached to a GridWifiChannel
+class GridWifiPhyHelper : public YansWifiPhyHelper
+{
+public:
+  GridWifiPhyHelper (const YansWifiPhyHelper &phy) : YansWifiPhyHelper (phy) {}
+  void SetChannel (Ptr<GridWifiChannel> channel) { m_gridChannel = channel; }
+
+private:
+  virtual Ptr<WifiPhy> Create (Ptr<Node> node, Ptr<NetDevice> device) const {
+    ObjectFactory factory = m_phy;
+    factory.SetTypeId (GridWifiPhy::GetTypeId ());
+    Ptr<GridWifiPhy> phy = factory.Create<GridWifiPhy> ();
+    phy->SetErrorRateModel (m_errorRateModel.Create<ErrorRateModel> ());
+    phy->SetGridChannel (m_gridChannel);
+    phy->SetDevice (device);
+    return phy;
+  }
+
+  Ptr<GridWifiChannel> m_gridChannel;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (GridWifiPhy);
+NS_OBJECT_ENSURE_REGISTERED (GridWifiChannel);
+
+inline TypeId GridWifiPhy::GetTypeId (void) {
+  static TypeId tid = TypeId ("ns3::GridWifiPhy")
+    .SetParent<YansWifiPhy> ()
+    .SetGroupName ("Wifi")
+    .AddConstructor<GridWifiPhy> ();
+  return tid;
+}
+
+inline void GridWifiPhy::SetGridChannel (Ptr<GridWifiChannel> channel) {
+  YansWifiPhy::SetChannel (channel);
+  channel->AddGridPhy (this);
+  m_gridChannel = channel;
+}
+
+inline void GridWifiPhy::StartTx (Ptr<Packet> packet, WifiTxVector txVector, Time txDuration) {
+  m_gridChannel->Send (this, packet, GetPowerDbm (txVector.GetTxPowerLevel ()) + GetTxGain (), txDuration);
+}
+
+inline TypeId GridWifiChannel::GetTypeId (void) {
+  static TypeId tid = TypeId ("ns3::GridWifiChannel")
+    .SetParent<YansWifiChannel> ()
+    .SetGroupName ("Wifi")
+    .AddConstructor<GridWifiChannel> ()
+    .AddAttribute ("CellSize", "Edge of a grid cell in meters",
+                   DoubleValue (50.0),
+                   MakeDoubleAccessor (&GridWifiChannel::m_cellSize),
+                   MakeDoubleChecker<double> (1.0))
+    .AddAttribute ("MaxRange", "Cull receivers beyond this range in meters, 0 derives it from the loss model",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&GridWifiChannel::m_maxRange),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("RefreshInterval", "How often moving nodes are re-binned between course changes",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&GridWifiChannel::m_refresh),
+                   MakeTimeChecker ())
+    .AddAttribute ("BatchLoss", "Evaluate Friis and Nakagami -> Friis chains with the vectorized batch kernel",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&GridWifiChannel::m_useBatchLoss),
+                   MakeBooleanChecker ());
+  return tid;
+}
+
+inline GridWifiChannel::GridWifiChannel ()
+  : m_bound (0),
+    m_useBatchLoss (true),
+    m_cellSize (50.0),
+    m_maxRange (0.0),
+    m_maxSpeed (0.0),
+    m_minRxDbm (std::numeric_limits<double>::infinity ()),
+    m_rangeTxPowerDbm (std::numeric_limits<double>::quiet_NaN ()),
+    m_range (std::numeric_limits<double>::infinity ())
+{
+}
+
+inline void GridWifiChannel::DoDispose (void) {
+  m_entries.clear ();
+  m_cells.clear ();
+  m_byMobility.clear ();
+  m_loss = 0;
+  m_delay = 0;
+  m_batchLoss = 0;
+  YansWifiChannel::DoDispose ();
+}
+
+inline void GridWifiChannel::SetPropagationLossModel (Ptr<PropagationLossModel> loss) {
+  YansWifiChannel::SetPropagationLossModel (loss);
+  m_loss = loss;
+  m_batchLoss = BatchLoss::FromModel (loss);
+  m_rangeTxPowerDbm = std::numeric_limits<double>::quiet_NaN ();
+}
+
+inline int64_t GridWifiChannel::AssignStreams (int64_t stream) {
+  int64_t streams = YansWifiChannel::AssignStreams (stream);
+  if (m_batchLoss) {
+    streams += m_batchLoss->AssignStreams (stream + streams);
+  }
+  return streams;
+}
+
+inline void GridWifiChannel::SetPropagationDelayModel (Ptr<PropagationDelayModel> delay) {
+  YansWifiChannel::SetPropagationDelayModel (delay);
+  m_delay = delay;
+}
+
+inline void GridWifiChannel::AddGridPhy (Ptr<GridWifiPhy> phy) {
+  Entry entry;
+  entry.phy = phy;
+  entry.cell = 0;
+  entry.slot = 0;
+  entry.moving = false;
+  m_entries.push_back (entry);
+}
+
+//Models that can only lower the power, so a range bound found further down
+//the chain still holds
+inline bool GridWifiChannel::IsPassiveLoss (Ptr<PropagationLossModel> model) {
+  return DynamicCast<FriisPropagationLossModel> (model) != 0
+         || DynamicCast<BuildingWallLossModel> (model) != 0;
+}
+
+//Walks a loss chain, including the models behind a cache, for the Friis
+//model that bounds the range; passive is cleared by any other model
+inline void GridWifiChannel::ScanLoss (Ptr<PropagationLossModel> model, Ptr<FriisPropagationLossModel> &friis, bool &passive) {
+  for (; model != 0; model = model->GetNext ()) {
+    Ptr<CachedPropagationLossModel> cached = DynamicCast<CachedPropagationLossModel> (model);
+    if (cached) {
+      ScanLoss (cached->GetCachedModel (), friis, passive);
+      continue;
+    }
+    passive = passive && IsPassiveLoss (model);
+    if (!friis) {
+      friis = DynamicCast<FriisPropagationLossModel> (model);
+    }
+  }
+}
+
+inline double GridWifiChannel::GetRange (double txPowerDbm) {
+  if (m_maxRange > 0) {
+    return m_maxRange;
+  }
+  if (txPowerDbm == m_rangeTxPowerDbm) {
+    return m_range;
+  }
+  double range = std::numeric_limits<double>::infinity ();
+  Ptr<FriisPropagationLossModel> friis;
+  bool passive = true;
+  ScanLoss (m_loss, friis, passive);
+  if (friis && passive && !std::isinf (m_minRxDbm)) {
+    //Friis: loss = 10 log10 (16 pi^2 d^2 L / lambda^2), clamped below by MinLoss
+    double budget = txPowerDbm - m_minRxDbm;
+    if (budget < friis->GetMinLoss ()) {
+      range = 0;
+    } else {
+      double lambda = 299792458.0 / friis->GetFrequency ();
+      range = lambda / (4 * M_PI * std::sqrt (friis->GetSystemLoss ())) * std::pow (10.0, budget / 20.0);
+      range *= 1.0 + 1e-9;
+    }
+  }
+  m_rangeTxPowerDbm = txPowerDbm;
+  m_range = range;
+  return range;
+}
+
+inline int64_t GridWifiChannel::CellKey (int64_t ix, int64_t iy) {
+  return (int64_t)(((uint64_t)ix << 32) ^ (uint32_t)iy);
+}
+
+inline int64_t GridWifiChannel::CellOf (const Vector &pos) const {
+  return CellKey ((int64_t)std::floor (pos.x / m_cellSize), (int64_t)std::floor (pos.y / m_cellSize));
+}
+
+inline void GridWifiChannel::Insert (uint32_t index) {
+  Entry &entry = m_entries[index];
+  entry.pos = entry.mobility->GetPosition ();
+  entry.cell = CellOf (entry.pos);
+  std::vector<uint32_t> &cell = m_cells[entry.cell];
+  entry.slot = cell.size ();
+  cell.push_back (index);
+}
+
+inline void GridWifiChannel::Remove (uint32_t index) {
+  Entry &entry = m_entries[index];
+  std::vector<uint32_t> &cell = m_cells[entry.cell];
+  cell[entry.slot] = cell.back ();
+  m_entries[cell[entry.slot]].slot = entry.slot;
+  cell.pop_back ();
+}
+
+//Mobility models are only reachable once the devices sit on nodes, so the
+//grid is filled on the first transmission and whenever PHYs are added
+inline void GridWifiChannel::Bind () {
+  for (; m_bound < m_entries.size (); m_bound++) {
+    Entry &entry = m_entries[m_bound];
+    entry.mobility = entry.phy->GetMobility ();
+    NS_ASSERT (entry.mobility != 0);
+    entry.mobility->TraceConnectWithoutContext ("CourseChange",
+                                                MakeCallback (&GridWifiChannel::CourseChanged, this));
+    m_byMobility[PeekPointer (entry.mobility)] = m_bound;
+    double speed = CalculateDistance (entry.mobility->GetVelocity (), Vector ());
+    entry.moving = speed > 0;
+    m_maxSpeed = std::max (m_maxSpeed, speed);
+    m_minRxDbm = std::min (m_minRxDbm, entry.phy->GetEdThreshold () - entry.phy->GetRxGain ());
+    m_rangeTxPowerDbm = std::numeric_limits<double>::quiet_NaN ();
+    Insert (m_bound);
+  }
+}
+
+inline void GridWifiChannel::CourseChanged (Ptr<const MobilityModel> mobility) {
+  std::unordered_map<const MobilityModel *, uint32_t>::const_iterator it = m_byMobility.find (PeekPointer (mobility));
+  if (it == m_byMobility.end ()) {
+    return;
+  }
+  double speed = CalculateDistance (mobility->GetVelocity (), Vector ());
+  m_entries[it->second].moving = speed > 0;
+  m_maxSpeed = std::max (m_maxSpeed, speed);
+  Remove (it->second);
+  Insert (it->second);
+}
+
+//Re-bins moving nodes so no stored position is older than RefreshInterval
+inline void GridWifiChannel::Refresh () {
+  if (Simulator::Now () < m_nextRefresh) {
+    return;
+  }
+  for (uint32_t i = 0; i < m_entries.size (); i++) {
+    if (m_entries[i].moving) {
+      Remove (i);
+      Insert (i);
+    }
+  }
+  m_nextRefresh = Simulator::Now () + m_refresh;
+}
+
+//Fills m_candidates with the receivers that may be within range of pos,
+//in PHY registration order like the stock channel
+inline void GridWifiChannel::Collect (const Vector &pos, double range) {
+  m_candidates.clear ();
+  double reach = range + m_maxSpeed * m_refresh.GetSeconds ();
+  int64_t span = std::isinf (reach) ? -1 : (int64_t)std::ceil (reach / m_cellSize);
+  if (span < 0 || (2 * span + 1) * (2 * span + 1) >= (int64_t)m_entries.size ()) {
+    for (uint32_t i = 0; i < m_entries.size (); i++) {
+      m_candidates.push_back (i);
+    }
+    return;
+  }
+  int64_t cx = (int64_t)std::floor (pos.x / m_cellSize);
+  int64_t cy = (int64_t)std::floor (pos.y / m_cellSize);
+  for (int64_t ix = cx - span; ix <= cx + span; ix++) {
+    for (int64_t iy = cy - span; iy <= cy + span; iy++) {
+      std::unordered_map<int64_t, std::vector<uint32_t> >::const_iterator cell = m_cells.find (CellKey (ix, iy));
+      if (cell == m_cells.end ()) {
+        continue;
+      }
+      for (uint32_t k = 0; k < cell->second.size (); k++) {
+        uint32_t index = cell->second[k];
+        if (CalculateDistance (m_entries[index].pos, pos) <= reach) {
+          m_candidates.push_back (index);
+        }
+      }
+    }
+  }
+  std::sort (m_candidates.begin (), m_candidates.end ());
+}
+
+inline void GridWifiChannel::Send (Ptr<GridWifiPhy> sender, Ptr<const Packet> packet, double txPowerDbm, Time duration) {
+  Bind ();
+  Refresh ();
+  Ptr<MobilityModel> senderMobility = sender->GetMobility ();
+  NS_ASSERT (senderMobility != 0);
+  Collect (senderMobility->GetPosition (), GetRange (txPowerDbm));
+
+  //Keep the receivers on the sender's channel number
+  uint32_t eligible = 0;
+  for (uint32_t k = 0; k < m_candidates.size (); k++) {
+    Entry &entry = m_entries[m_candidates[k]];
+    if (entry.phy != sender && entry.phy->GetChannelNumber () == sender->GetChannelNumber ()) {
+      m_candidates[eligible++] = m_candidates[k];
+    }
+  }
+  m_candidates.resize (eligible);
+
+  //Receiver powers, all at once when the loss chain has a batch kernel
+  m_rxPowers.resize (m_candidates.size ());
+  if (m_batchLoss && m_useBatchLoss) {
+    m_positions.Clear ();
+    for (uint32_t k = 0; k < m_candidates.size (); k++) {
+      m_positions.Add (m_entries[m_candidates[k]].mobility->GetPosition ());
+    }
+    m_batchLoss->CalcRxPower (txPowerDbm, senderMobility->GetPosition (), m_positions, m_rxPowers);
+  } else {
+    for (uint32_t k = 0; k < m_candidates.size (); k++) {
+      m_rxPowers[k] = m_loss->CalcRxPower (txPowerDbm, senderMobility, m_entries[m_candidates[k]].mobility);
+    }
+  }
+
+  //Threshold and delay; one event per receiver in its own node's context
+  for (uint32_t k = 0; k < m_candidates.size (); k++) {
+    Entry &entry = m_entries[m_candidates[k]];
+    double rxPowerDbm = m_rxPowers[k];
+    if (rxPowerDbm + entry.phy->GetRxGain () < entry.phy->GetEdThreshold ()) {
+      continue;
+    }
+    Ptr<NetDevice> device = entry.phy->GetDevice ();
+    uint32_t dstNode = device == 0 ? 0xffffffff : device->GetNode ()->GetId ();
+    Time delay = m_delay->GetDelay (senderMobility, entry.mobility);
+    Simulator::ScheduleWithContext (dstNode, delay, &GridWifiChannel::Receive,
+                                    entry.phy, packet->Copy (), rxPowerDbm, duration);
+  }
+}
+
+inline void GridWifiChannel::Receive (Ptr<YansWifiPhy> phy, Ptr<Packet> packet, double rxPowerDbm, Time duration) {
+  if (rxPowerDbm + phy->GetRxGain () < phy->GetEdThreshold ()) {
+    return;
+  }
+  double rxPowerW = std::pow (10.0, (rxPowerDbm + phy->GetRxGain ()) / 10.0) / 1000.0;
+  phy->StartReceivePreamble (packet, rxPowerW, duration);
+}
+
+} // namespace ns3
+
+#endif /* GRID_WIFI_CHANNEL_H */
@@ -0,0 +1,52 @@
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include "latency-histogram.h"
+
+using namespace std;
+
+//Merges the HDR1 histograms of any number of --histFile outputs (shards,
+//protocols, replications) by label and prints their percentiles as CSV.
+//Labels are <scenario>/<protocol>/k<nSinks>/<flow>/<delay|jitter>; with
+//--all only the per-run totals (flow "all") are kept.
+int main (int argc, char *argv[]) {
+  bool allOnly = false;
+  int first = 1;
+  if (argc > 1 && string (argv[1]) == "--all") {
+    allOnly = true;
+    first = 2;
+  }
+  if (first >= argc) {
+    cerr << "usage: hist-merge [--all] <file>...\n";
+    return 1;
+  }
+  map<string, LatencyHistogram> merged;
+  for (int a = first; a < argc; a++) {
+    ifstream in (argv[a], ios::binary);
+    if (!in) {
+      cerr << "cannot open " << argv[a] << "\n";
+      return 1;
+    }
+    LatencyHistogram block;
+    string label;
+    while (block.Read (in, label)) {
+      if (!allOnly || label.find ("/all/") != string::npos) {
+        merged[label].Merge (block);
+      }
+    }
+    if (!in.eof ()) {
+      cerr << "bad block in " << argv[a] << "\n";
+      return 1;
+    }
+  }
+  cout << "Label,Count,MinMs,MeanMs,P50Ms,P90Ms,P99Ms,P999Ms,MaxMs\n";
+  for (map<string, LatencyHistogram>::const_iterator i = merged.begin (); i != merged.end (); ++i) {
+    const LatencyHistogram &h = i->second;
+    cout << i->first << "," << h.GetCount () << "," << h.GetMin () / 1e6 << ","
+         << h.GetMean () / 1e6 << "," << h.GetPercentile (50) / 1e6 << ","
+         << h.GetPercentile (90) / 1e6 << "," << h.GetPercentile (99) / 1e6 << ","
+         << h.GetPercentile (99.9) / 1e6 << "," << h.GetMax () / 1e6 << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,174 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//HDR-style histogram of non-negative integer values (nanoseconds here).
+//Values below 128 get a bucket each; above that every power of two is cut
+//into 64 buckets, so a bucket is never wider than 1/64 of its values and
+//percentiles are within 1.6% of the recorded value whatever the range.
+//Values up to 2^40 (about 18 minutes in ns) fit in 2240 fixed counters;
+//larger ones go to the last bucket. Min, max and mean are exact.
+//
+//Histograms with the same layout merge by adding counters, so runs and
+//replications are combined without keeping samples. Write/Read store one
+//as a labelled block of its non-zero buckets:
+//  char magic[4] = "HDR1", uint32_t labelLength, char label[labelLength],
+//  uint64_t count, int64_t min, int64_t max, double sum,
+//  uint32_t buckets, {uint32_t index, uint64_t count}[buckets]
+class LatencyHistogram
+{
+public:
+  LatencyHistogram () : m_counts (GetNBuckets (), 0) { Clear (); }
+
+  void Record (int64_t value) {
+    value = std::max<int64_t> (value, 0);
+    m_counts[GetIndex (value)]++;
+    m_count++;
+    m_sum += value;
+    m_min = std::min (m_min, value);
+    m_max = std::max (m_max, value);
+  }
+
+  void Merge (const LatencyHistogram &other) {
+    for (size_t i = 0; i < m_counts.size (); i++) {
+      m_counts[i] += other.m_counts[i];
+    }
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_min = std::min (m_min, other.m_min);
+    m_max = std::max (m_max, other.m_max);
+  }
+
+  void Clear () {
+    std::fill (m_counts.begin (), m_counts.end (), 0);
+    m_count = 0;
+    m_sum = 0;
+    m_min = INT64_MAX;
+    m_max = 0;
+  }
+
+  uint64_t GetCount () const { return m_count; }
+  int64_t GetMin () const { return m_count > 0 ? m_min : 0; }
+  int64_t GetMax () const { return m_max; }
+  double GetMean () const { return m_count > 0 ? m_sum / m_count : 0; }
+
+  //Smallest recorded value v with at least percentile % of the values <= v,
+  //to bucket precision
+  int64_t GetPercentile (double percentile) const {
+    if (m_count == 0) {
+      return 0;
+    }
+    uint64_t rank = (uint64_t)std::ceil (percentile / 100 * m_count);
+    rank = std::min (std::max<uint64_t> (rank, 1), m_count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < m_counts.size (); i++) {
+      seen += m_counts[i];
+      if (seen >= rank) {
+        return std::min (std::max (GetHighest (i), m_min), m_max);
+      }
+    }
+    return m_max;
+  }
+
+  void Write (std::ostream &out, const std::string &label) const {
+    uint32_t length = label.size ();
+    uint32_t buckets = m_counts.size () - std::count (m_counts.begin (), m_counts.end (), 0);
+    int64_t min = GetMin ();
+    out.write ("HDR1", 4);
+    out.write ((const char *)&length, sizeof (length));
+    out.write (label.data (), length);
+    out.write ((const char *)&m_count, sizeof (m_count));
+    out.write ((const char *)&min, sizeof (min));
+    out.write ((const char *)&m_max, sizeof (m_max));
+    out.write ((const char *)&m_sum, sizeof (m_sum));
+    out.write ((const char *)&buckets, sizeof (buckets));
+    for (uint32_t i = 0; i < m_counts.size (); i++) {
+      if (m_counts[i] > 0) {
+        out.write ((const char *)&i, sizeof (i));
+        out.write ((const char *)&m_counts[i], sizeof (m_counts[i]));
+      }
+    }
+  }
+
+  //Reads one block into this histogram; false at end of input or on a bad block
+  bool Read (std::istream &in, std::string &label) {
+    char magic[4];
+    uint32_t length = 0, buckets = 0;
+    Clear ();
+    if (!in.read (magic, 4) || std::memcmp (magic, "HDR1", 4) != 0
+        || !in.read ((char *)&length, sizeof (length)) || length > 4096) {
+      return false;
+    }
+    label.resize (length);
+    if ((length > 0 && !in.read (&label[0], length))
+        || !in.read ((char *)&m_count, sizeof (m_count))
+        || !in.read ((char *)&m_min, sizeof (m_min))
+        || !in.read ((char *)&m_max, sizeof (m_max))
+        || !in.read ((char *)&m_sum, sizeof (m_sum))
+        || !in.read ((char *)&buckets, sizeof (buckets))) {
+      return false;
+    }
+    if (m_count == 0) {
+      m_min = INT64_MAX;
+    }
+    for (uint32_t b = 0; b < buckets; b++) {
+      uint32_t i;
+      uint64_t count;
+      if (!in.read ((char *)&i, sizeof (i)) || !in.read ((char *)&count, sizeof (count))
+          || i >= m_counts.size ()) {
+        return false;
+      }
+      m_counts[i] = count;
+    }
+    return true;
+  }
+
+private:
+  static const int SUB_BITS = 7;
+  static const int MAX_BITS = 40;
+
+  static size_t GetNBuckets () {
+    return (MAX_BITS - SUB_BITS + 2) << (SUB_BITS - 1);
+  }
+
+  //Values below 2^SUB_BITS map to themselves; above, the top SUB_BITS bits
+  //of the value select one of 2^(SUB_BITS-1) buckets per power of two
+  static size_t GetIndex (int64_t value) {
+    uint64_t v = value;
+    if (v >> MAX_BITS) {
+      return GetNBuckets () - 1;
+    }
+    if (v < (1u << SUB_BITS)) {
+      return v;
+    }
+    int msb = 63 - __builtin_clzll (v);
+    int shift = msb - SUB_BITS + 1;
+    return ((size_t)shift << (SUB_BITS - 1)) + (v >> shift);
+  }
+
+  //Largest value that falls into bucket index
+  static int64_t GetHighest (size_t index) {
+    size_t half = 1u << (SUB_BITS - 1);
+    if (index < 2 * half) {
+      return index;
+    }
+    int shift = index / half - 1;
+    int64_t sub = index - (size_t)shift * half;
+    return ((sub + 1) << shift) - 1;
+  }
+
+  std::vector<uint64_t> m_counts;
+  uint64_t m_count;
+  double m_sum;
+  int64_t m_min;
+  int64_t m_max;
+};
+
+#endif /* LATENCY_HISTOGRAM_H */
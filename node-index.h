@@ -0,0 +1,144 @@
+#ifndef NODE_INDEX_H
+#define NODE_INDEX_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "campus-scenario.h"
+
+namespace ns3 {
+
+//Who is behind an address of the campus: node, building and role
+struct NodeInfo
+{
+  enum Role { SOURCE = 1, SINK = 2, RELAY = 4, BASE_STATION = 8 };
+
+  uint32_t index;      //in the campus NodeContainer
+  uint32_t node;       //ns-3 node id
+  int32_t building;    //-1 outside any building
+  uint32_t roles;      //Role bits
+  Ptr<MobilityModel> mobility;
+
+  std::string GetRoleName () const {
+    std::string name;
+    const char *names[] = { "source", "sink", "relay", "base station" };
+    for (int r = 0; r < 4; r++) {
+      if (roles & (1u << r)) {
+        name += (name.empty () ? "" : "+") + std::string (names[r]);
+      }
+    }
+    return name.empty () ? "node" : name;
+  }
+};
+
+//Address to node lookup for flow reports, built once the interfaces are
+//assigned. The addresses live in a flat open-addressing table (linear
+//probing, at most half full) next to a vector of NodeInfo, so a lookup is
+//one hash and usually one probe, without per-entry allocations.
+class NodeIndex
+{
+public:
+  NodeIndex () : m_mask (0) {}
+
+  //Relays and base stations come from the campus layout; sources and
+  //sinks are added with AddRole
+  void Build (const Ipv4InterfaceContainer &interfaces, const NodeContainer &nodes,
+              const CampusScenario &campus) {
+    m_nodes.clear ();
+    uint32_t size = 16;
+    while (size < 2 * interfaces.GetN ()) {
+      size *= 2;
+    }
+    m_slots.assign (size, Slot ());
+    m_mask = size - 1;
+    for (uint32_t i = 0; i < interfaces.GetN () && i < nodes.GetN (); i++) {
+      NodeInfo info;
+      info.index = i;
+      info.node = nodes.Get (i)->GetId ();
+      info.building = campus.GetNodeBuilding (i);
+      info.roles = campus.GetNodeRoles (i) & (NodeInfo::RELAY | NodeInfo::BASE_STATION);
+      info.mobility = nodes.Get (i)->GetObject<MobilityModel> ();
+      Insert (interfaces.GetAddress (i, 0).Get (), m_nodes.size ());
+      m_nodes.push_back (info);
+    }
+  }
+
+  void AddRole (uint32_t index, NodeInfo::Role role) {
+    if (index < m_nodes.size ()) {
+      m_nodes[index].roles |= role;
+    }
+  }
+
+  //0 for addresses outside the campus (e.g. broadcast)
+  const NodeInfo *Find (Ipv4Address address) const {
+    if (m_slots.empty ()) {
+      return 0;
+    }
+    uint32_t key = address.Get ();
+    for (uint32_t s = Hash (key) & m_mask; m_slots[s].used; s = (s + 1) & m_mask) {
+      if (m_slots[s].key == key) {
+        return &m_nodes[m_slots[s].value];
+      }
+    }
+    return 0;
+  }
+
+  uint32_t GetN () const { return m_nodes.size (); }
+  const NodeInfo &Get (uint32_t index) const { return m_nodes[index]; }
+
+  //"node 12 (b1 sink) at (30, 4)", or just the address if it is unknown
+  std::string Describe (Ipv4Address address) const {
+    std::ostringstream os;
+    const NodeInfo *info = Find (address);
+    if (info == 0) {
+      os << address;
+      return os.str ();
+    }
+    os << "node " << info->node << " (";
+    if (info->building >= 0) {
+      os << "b" << info->building + 1 << " ";
+    }
+    os << info->GetRoleName () << ")";
+    if (info->mobility != 0) {
+      Vector p = info->mobility->GetPosition ();
+      os << " at (" << p.x << ", " << p.y << ")";
+    }
+    return os.str ();
+  }
+
+private:
+  struct Slot
+  {
+    Slot () : key (0), value (0), used (false) {}
+    uint32_t key;
+    uint32_t value;
+    bool used;
+  };
+
+  static uint32_t Hash (uint32_t key) {
+    return (key * 2654435761u) >> 7;
+  }
+
+  void Insert (uint32_t key, uint32_t value) {
+    uint32_t s = Hash (key) & m_mask;
+    while (m_slots[s].used && m_slots[s].key != key) {
+      s = (s + 1) & m_mask;
+    }
+    m_slots[s].key = key;
+    m_slots[s].value = value;
+    m_slots[s].used = true;
+  }
+
+  std::vector<Slot> m_slots;
+  uint32_t m_mask;
+  std::vector<NodeInfo> m_nodes;
+};
+
+} // namespace ns3
+
+#endif /* NODE_INDEX_H */
@@ -0,0 +1,87 @@
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include <unordered_map>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+namespace ns3 {
+
+//Free lists of payload-only packets, one per size. Receivers hand their
+//packets back with Recycle once the stack has stripped the headers, and
+//senders take them again with Allocate instead of Create<Packet>. A reused
+//packet keeps its Buffer, so the headers of the next send go into the
+//space the old ones left and neither the Packet nor its data is allocated.
+//Tags are cleared on reuse; the packet uid is not, so uids repeat.
+//A packet is only reused once the pool holds the last reference to it.
+class PacketPool
+{
+public:
+  PacketPool () : m_limit (1024), m_created (0), m_reused (0), m_recycled (0), m_dropped (0) {}
+
+  //Pool shared by every source and sink of the simulation
+  static PacketPool &Default () {
+    static PacketPool pool;
+    return pool;
+  }
+
+  //Packets kept per size; more are left to be freed
+  void SetLimit (uint32_t limit) { m_limit = limit; }
+
+  Ptr<Packet> Allocate (uint32_t size) {
+    std::vector<Ptr<Packet> > &free = m_free[size];
+    while (!free.empty ()) {
+      Ptr<Packet> packet = free.back ();
+      free.pop_back ();
+      if (packet->GetReferenceCount () == 1) {
+        packet->RemoveAllPacketTags ();
+        packet->RemoveAllByteTags ();
+        m_reused++;
+        return packet;
+      }
+      m_dropped++;
+    }
+    m_created++;
+    return Create<Packet> (size);
+  }
+
+  //The caller must not touch the packet afterwards
+  void Recycle (Ptr<Packet> packet) {
+    std::vector<Ptr<Packet> > &free = m_free[packet->GetSize ()];
+    if (free.size () < m_limit) {
+      free.push_back (packet);
+      m_recycled++;
+    } else {
+      m_dropped++;
+    }
+  }
+
+  void Clear () { m_free.clear (); }
+  //Starts the counters over, e.g. for the next run of the same process
+  void ResetStats () { m_created = m_reused = m_recycled = m_dropped = 0; }
+
+  uint64_t GetCreated () const { return m_created; }
+  uint64_t GetReused () const { return m_reused; }
+  uint64_t GetRecycled () const { return m_recycled; }
+  //Packets handed back but freed, because the pool was full or the
+  //packet was still referenced elsewhere when it came up for reuse
+  uint64_t GetDropped () const { return m_dropped; }
+
+  void Print (std::ostream &os) const {
+    os << "Packet pool: " << m_created << " created, " << m_reused << " reused, "
+       << m_recycled << " recycled, " << m_dropped << " dropped\n";
+  }
+
+private:
+  std::unordered_map<uint32_t, std::vector<Ptr<Packet> > > m_free;
+  uint32_t m_limit;
+  uint64_t m_created;
+  uint64_t m_reused;
+  uint64_t m_recycled;
+  uint64_t m_dropped;
+};
+
+} // namespace ns3
+
+#endif /* PACKET_POOL_H */
@@ -0,0 +1,83 @@
+#ifndef PARALLEL_RUNS_H
+#define PARALLEL_RUNS_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//Runs several independent experiments at once, one forked process each.
+//ns-3's Simulator, NodeList and RNG state are process-wide singletons, so a
+//process is the smallest unit that can own a whole simulator instance.
+//Every child writes to its own shards (stdout, CSV) and the parent
+//merges them in run order, which makes the result look like the serial loop.
+
+inline std::string ShardSuffix (int run, const std::string &prefix = ".p") {
+  return prefix + std::to_string (run);
+}
+
+//Appends the contents of 'from' to 'to' and removes 'from'
+inline void AppendShard (const std::string &from, std::ostream &to) {
+  std::ifstream in (from.c_str (), std::ios::binary);
+  if (in) {
+    to << in.rdbuf ();
+    in.close ();
+  }
+  std::remove (from.c_str ());
+}
+
+//Forks run (i) for every i in runs and waits for all of them. Inside the
+//child, stdout goes to <csv><prefix><i>.out and run (i) is expected to
+//write <csv><prefix><i>. The shards are merged back in order: stdout is
+//replayed and CSV rows are appended, exactly as with the serial loop.
+//Children may fork again with another prefix, e.g. .p1 then .p1.k3.
+template <class RunFn>
+bool ForkRuns (const std::vector<int> &runs, RunFn run, const std::string &csv,
+               const std::string &prefix = ".p") {
+  std::vector<pid_t> children;
+  std::cout.flush ();
+  fflush (stdout);
+  for (size_t r = 0; r < runs.size (); r++) {
+    int i = runs[r];
+    pid_t pid = fork ();
+    if (pid < 0) {
+      perror ("fork");
+      break;
+    }
+    if (pid == 0) {
+      if (!freopen ((csv + ShardSuffix (i, prefix) + ".out").c_str (), "w", stdout)) {
+        _exit (1);
+      }
+      run (i);
+      std::cout.flush ();
+      fflush (stdout);
+      exit (0);
+    }
+    children.push_back (pid);
+  }
+
+  bool ok = children.size () == runs.size ();
+  for (size_t c = 0; c < children.size (); c++) {
+    int status = 0;
+    waitpid (children[c], &status, 0);
+    if (!WIFEXITED (status) || WEXITSTATUS (status) != 0) {
+      std::cerr << "run " << runs[c] << " failed\n";
+      ok = false;
+    }
+  }
+
+  std::ofstream out (csv.c_str (), std::ios::app);
+  for (size_t r = 0; r < runs.size (); r++) {
+    AppendShard (csv + ShardSuffix (runs[r], prefix) + ".out", std::cout);
+    AppendShard (csv + ShardSuffix (runs[r], prefix), out);
+  }
+  out.close ();
+  return ok;
+}
+
+#endif /* PARALLEL_RUNS_H */
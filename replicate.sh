@@ -0,0 +1,135 @@
+#!/bin/bash
+# Runs independent replications of one scenario, --RngRun=1,2,3,... on
+# every core, until the 95% confidence intervals of throughput and
+# delivery ratio are tight enough. Run from the ns-3 top directory (same
+# place as sweep.sh).
+#
+# ./replicate.sh [-s scenario] [-e precision] [-m min] [-M max] [-j jobs]
+#                [-o outdir] [-B] [-- extra scenario arguments]
+#
+# -e is the CI half-width relative to the mean (0.05 = +-5%); every
+# protocol and nSinks value must reach it for both metrics. Replications
+# run in batches of -j, at least -m and at most -M of them. Each batch
+# prints the running means and intervals; <outdir>/results.csv has one row
+# per replication and protocol from the scenarios' RESULT lines.
+
+SCENARIO="manet"
+PRECISION=0.05
+MIN=5
+MAX=100
+JOBS=$(nproc 2>/dev/null || echo 1)
+OUT="replicate"
+BUILD=1
+
+while getopts "s:e:m:M:j:o:B" opt; do
+  case $opt in
+    s) SCENARIO=$OPTARG ;;
+    e) PRECISION=$OPTARG ;;
+    m) MIN=$OPTARG ;;
+    M) MAX=$OPTARG ;;
+    j) JOBS=$OPTARG ;;
+    o) OUT=$OPTARG ;;
+    B) BUILD=0 ;;
+    *) echo "usage: $0 [-s scenario] [-e precision] [-m min] [-M max] [-j jobs] [-o outdir] [-B] [-- extra scenario arguments]" >&2
+       exit 1 ;;
+  esac
+done
+shift $((OPTIND-1))
+
+if [ $BUILD -eq 1 ]; then
+  ./waf build || exit 1
+fi
+
+#same lookup as sweep.sh
+find_binary () {
+  local b
+  for b in build/scratch/$1 build/scratch/ns3*-$1-*; do
+    if [ -x "$b" ] && [ -f "$b" ]; then
+      echo "$PWD/$b"
+      return 0
+    fi
+  done
+  return 1
+}
+
+BIN=$(find_binary "$SCENARIO") || { echo "no binary for $SCENARIO, build it first" >&2; exit 1; }
+export LD_LIBRARY_PATH="$PWD/build/lib${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}"
+mkdir -p "$OUT/runs"
+OUT=$(cd "$OUT" && pwd)
+
+#one replication in its own directory; protocols run serially inside it,
+#the cores are used by running replications side by side
+run_one () {
+  local r=$1
+  shift
+  local dir="$OUT/runs/r$r"
+  mkdir -p "$dir"
+  (cd "$dir" && "$BIN" --RngRun=$r --parallel=0 "$@" \
+      --CSVfileName=throughput.csv > stdout.txt 2> stderr.txt)
+  echo $? > "$dir/status"
+}
+export -f run_one
+export OUT BIN
+
+#Running mean and 95% CI of every metric; exits 0 once all are within
+#PRECISION of their mean
+summarize () {
+  awk -F, -v eps=$PRECISION '
+    function t95 (df) {
+      split ("12.706 4.303 3.182 2.776 2.571 2.447 2.365 2.306 2.262 2.228 2.201 2.179 2.160 2.145 2.131 2.120 2.110 2.101 2.093 2.086 2.080 2.074 2.069 2.064 2.060 2.056 2.052 2.048 2.045 2.042", t, " ")
+      if (df <= 30) return t[df]
+      if (df <= 40) return 2.042
+      if (df <= 60) return 2.021
+      if (df <= 120) return 2.000
+      return 1.980
+    }
+    NR > 1 {
+      key = $2 "," $3
+      if (!(key in n)) keys[++nk] = key
+      n[key]++; s1[key] += $4; q1[key] += $4 * $4; s2[key] += $5; q2[key] += $5 * $5
+    }
+    function report (name, sum, sq, k,    mean, var, h) {
+      mean = sum / n[k]
+      var = n[k] > 1 ? (sq - sum * sum / n[k]) / (n[k] - 1) : 0
+      h = n[k] > 1 ? t95(n[k] - 1) * sqrt (var > 0 ? var : 0) / sqrt (n[k]) : 0
+      printf "  %s %s: %.4g +- %.3g (%d runs)\n", k, name, mean, h, n[k]
+      if (n[k] < 2 || h > eps * (mean < 0 ? -mean : mean)) done = 0
+    }
+    END {
+      done = nk > 0
+      for (i = 1; i <= nk; i++) {
+        report("kbps", s1[keys[i]], q1[keys[i]], keys[i])
+        report("pdr", s2[keys[i]], q2[keys[i]], keys[i])
+      }
+      exit done ? 0 : 1
+    }' "$OUT/results.csv"
+}
+
+echo "Run,Protocol,NumberOfSinks,ThroughputKbps,DeliveryRatio,Sent,Delivered" > "$OUT/results.csv"
+next=1
+while [ $next -le $MAX ]; do
+  last=$((next + JOBS - 1))
+  if [ $last -gt $MAX ]; then
+    last=$MAX
+  fi
+  seq $next $last | xargs -P "$JOBS" -I{} bash -c 'run_one "$@"' _ {} "$@"
+  #collect in run order so the result set does not depend on scheduling
+  for r in $(seq $next $last); do
+    dir="$OUT/runs/r$r"
+    if [ "$(cat "$dir/status")" != "0" ]; then
+      echo "replication $r failed, see $dir/stderr.txt" >&2
+      continue
+    fi
+    grep '^RESULT,' "$dir/stdout.txt" | sed "s/^RESULT,/$r,/" >> "$OUT/results.csv"
+  done
+  echo "after replications 1-$last:"
+  summarize
+  converged=$?
+  next=$((last + 1))
+  if [ $last -ge $MIN ] && [ $converged -eq 0 ]; then
+    echo "within ${PRECISION} of the mean after $last replications"
+    exit 0
+  fi
+done
+echo "precision ${PRECISION} not reached after $MAX replications" >&2
+exit 1
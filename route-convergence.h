@@ -0,0 +1,139 @@
+#ifndef ROUTE_CONVERGENCE_H
+#define ROUTE_CONVERGENCE_H
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+namespace ns3 {
+
+//Watches the routing tables of a set of nodes and calls back once they have
+//not changed for a whole window, or at the deadline if they never settle.
+//Every interval each node's Ipv4RoutingProtocol prints its table into a
+//string; the table is reduced to a digest of its addresses and state words
+//(UP, IN_SEARCH, ...) so expiry timers, sequence numbers and hop counts
+//ticking over are not counted as churn. Works with OLSR, AODV and DSDV, or
+//anything else behind Ipv4ListRouting that implements PrintRoutingTable.
+class RouteConvergence
+{
+public:
+  RouteConvergence ()
+    : m_interval (Seconds (0.5)),
+      m_window (Seconds (5)),
+      m_deadline (Seconds (50)),
+      m_changes (0),
+      m_converged (false)
+  {
+  }
+
+  void SetInterval (Time interval) { m_interval = interval; }
+  void SetWindow (Time window) { m_window = window; }
+  //Absolute time at which done is called even if the tables still change
+  void SetDeadline (Time deadline) { m_deadline = deadline; }
+
+  void Start (NodeContainer nodes, std::function<void ()> done) {
+    m_nodes = nodes;
+    m_onDone = done;
+    m_digests.assign (nodes.GetN (), 0);
+    m_lastChange = Simulator::Now ();
+    m_changes = 0;
+    m_converged = false;
+    m_event = Simulator::ScheduleNow (&RouteConvergence::Check, this);
+  }
+
+  void Cancel () { m_event.Cancel (); }
+
+  //False when the deadline was hit first
+  bool IsConverged () const { return m_converged; }
+  Time GetLastChange () const { return m_lastChange; }
+  //Node tables seen changing, summed over all checks
+  uint64_t GetChanges () const { return m_changes; }
+
+private:
+  static bool IsAddress (const std::string &token) {
+    int dots = 0;
+    for (size_t i = 0; i < token.size (); i++) {
+      if (token[i] == '.') {
+        dots++;
+      } else if (!std::isdigit ((unsigned char)token[i])) {
+        return false;
+      }
+    }
+    return dots == 3;
+  }
+
+  static bool IsState (const std::string &token) {
+    for (size_t i = 0; i < token.size (); i++) {
+      if (!std::isupper ((unsigned char)token[i]) && token[i] != '_') {
+        return false;
+      }
+    }
+    return !token.empty ();
+  }
+
+  //FNV-1a over the address and state tokens of the printed table
+  static uint64_t Digest (Ptr<Node> node) {
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+    if (ipv4 == 0 || ipv4->GetRoutingProtocol () == 0) {
+      return 0;
+    }
+    std::ostringstream table;
+    ipv4->GetRoutingProtocol ()->PrintRoutingTable (Create<OutputStreamWrapper> (&table));
+    std::istringstream in (table.str ());
+    std::string token;
+    uint64_t hash = 14695981039346656037ULL;
+    while (in >> token) {
+      if (IsAddress (token) || IsState (token)) {
+        for (size_t i = 0; i < token.size (); i++) {
+          hash = (hash ^ (unsigned char)token[i]) * 1099511628211ULL;
+        }
+        hash = (hash ^ ' ') * 1099511628211ULL;
+      }
+    }
+    return hash;
+  }
+
+  void Check () {
+    for (uint32_t n = 0; n < m_nodes.GetN (); n++) {
+      uint64_t digest = Digest (m_nodes.Get (n));
+      if (digest != m_digests[n]) {
+        m_digests[n] = digest;
+        m_lastChange = Simulator::Now ();
+        m_changes++;
+      }
+    }
+    //The first check only records the initial tables; empty tables that
+    //have not filled yet do not count as converged
+    Time now = Simulator::Now ();
+    bool settled = m_changes > m_nodes.GetN () && now - m_lastChange >= m_window;
+    if (settled || now >= m_deadline) {
+      m_converged = settled;
+      m_onDone ();
+      return;
+    }
+    Time next = std::min (m_interval, m_deadline - now);
+    m_event = Simulator::Schedule (next, &RouteConvergence::Check, this);
+  }
+
+  Time m_interval;
+  Time m_window;
+  Time m_deadline;
+  NodeContainer m_nodes;
+  std::function<void ()> m_onDone;
+  std::vector<uint64_t> m_digests;
+  Time m_lastChange;
+  uint64_t m_changes;
+  bool m_converged;
+  EventId m_event;
+};
+
+} // namespace ns3
+
+#endif /* ROUTE_CONVERGENCE_H */
@@ -0,0 +1,80 @@
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include <chrono>
+#include <iostream>
+#include <sys/resource.h>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/wifi-module.h"
+#include "alloc-counter.h"
+
+namespace ns3 {
+
+//Wall-clock cost of a run since Start (): PHY transmissions started
+//(PhyTxBegin on every wifi device), simulator events, heap allocations and
+//peak RSS. Print writes a "Run stats:" line for people and a "Bench," CSV
+//line for bench.sh with the fields
+//  wall_s,sim_s,phy_tx,events,events_per_s,sim_per_wall,peak_rss_kb,
+//  allocations,delivered,allocs_per_packet
+class RunStats
+{
+public:
+  RunStats () : m_phyTx (0), m_events (0), m_allocations (0) {}
+
+  //Call once the wifi devices are installed
+  void Install () {
+    Config::ConnectWithoutContext ("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/PhyTxBegin",
+                                   MakeCallback (&RunStats::PhyTx, this));
+  }
+
+  void Start () {
+    m_phyTx = 0;
+    m_events = Simulator::GetEventCount ();
+    m_allocations = GetAllocationCount ();
+    m_wallStart = std::chrono::steady_clock::now ();
+    m_simStart = Simulator::Now ();
+  }
+
+  double GetWallSeconds () const {
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now () - m_wallStart;
+    return wall.count ();
+  }
+  uint64_t GetPhyTx () const { return m_phyTx; }
+  uint64_t GetEvents () const { return Simulator::GetEventCount () - m_events; }
+  uint64_t GetAllocations () const { return GetAllocationCount () - m_allocations; }
+
+  //Largest resident set of the process so far, in kB (Linux units)
+  static long GetPeakRss () {
+    struct rusage usage;
+    getrusage (RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+  }
+
+  //delivered: application packets received since Start ()
+  void Print (std::ostream &os, uint64_t delivered) const {
+    double wall = GetWallSeconds ();
+    double sim = (Simulator::Now () - m_simStart).GetSeconds ();
+    uint64_t events = GetEvents ();
+    uint64_t allocations = GetAllocations ();
+    os << "Run stats: " << m_phyTx << " phy tx, " << sim << " s simulated in "
+       << wall << " s wall, " << (wall > 0 ? m_phyTx / wall : 0) << " packets/s\n";
+    os << "Bench," << wall << "," << sim << "," << m_phyTx << "," << events << ","
+       << (wall > 0 ? events / wall : 0) << "," << (wall > 0 ? sim / wall : 0) << ","
+       << GetPeakRss () << "," << allocations << "," << delivered << ","
+       << (delivered > 0 ? (double)allocations / delivered : 0) << "\n";
+  }
+
+private:
+  void PhyTx (Ptr<const Packet> packet) { m_phyTx++; }
+
+  uint64_t m_phyTx;
+  uint64_t m_events;
+  uint64_t m_allocations;
+  std::chrono::steady_clock::time_point m_wallStart;
+  Time m_simStart;
+};
+
+} // namespace ns3
+
+#endif /* RUN_STATS_H */
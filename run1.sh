@@ -1,2 +1,15 @@
 #!/bin/bash
-./waf --run "manet --nSinks=1" > 1-0-1.txt
+#Only the options that do not change which runs exist (-j jobs, -c cachedir,
+#-C, -B) are passed to sweep.sh; the output below is read from the single
+#lab run, so its scenario, sinks, power, nSep and seed are fixed
+PASS=()
+while getopts "j:c:CB" opt; do
+  case $opt in
+    j|c) PASS+=("-$opt" "$OPTARG") ;;
+    C|B) PASS+=("-$opt") ;;
+    *) echo "usage: $0 [-j jobs] [-c cachedir] [-C] [-B]" >&2
+       exit 1 ;;
+  esac
+done
+./sweep.sh -s manet -k "1" -p 15 -n 2 -r 1 -o sweep-1 "${PASS[@]}"
+cp sweep-1/runs/manet-k1-p15-n2-r1/stdout.txt 1-0-1.txt
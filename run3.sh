@@ -1,6 +1,20 @@
 #!/bin/bash
-./waf --run "center-manet --nSinks=1" > 3-0-1.txt
-./waf --run "center-manet --nSinks=2" > 3-0-2.txt
-./waf --run "center-manet --nSinks=3" > 3-0-3.txt
-./waf --run "center-manet --nSinks=4" > 3-0-4.txt
-./waf --run "center-manet --nSinks=5" > 3-0-5.txt
+#Only the options that do not change which runs exist (-j jobs, -c cachedir,
+#-C, -B) are passed to sweep.sh; the output below is read from the single
+#lab run, so its scenario, sinks, power, nSep and seed are fixed
+PASS=()
+while getopts "j:c:CB" opt; do
+  case $opt in
+    j|c) PASS+=("-$opt" "$OPTARG") ;;
+    C|B) PASS+=("-$opt") ;;
+    *) echo "usage: $0 [-j jobs] [-c cachedir] [-C] [-B]" >&2
+       exit 1 ;;
+  esac
+done
+#One run: the routing warm-up is simulated once and forked for nSinks 1..5
+./sweep.sh -s center-manet -w "1,2,3,4,5" -p 15 -n 2 -r 1 -o sweep-3 "${PASS[@]}"
+#lines before the first branch of a protocol (banner, convergence) go to every nSinks file
+awk '/^~+[A-Z]+~+$/ {head=$0; f=""; next}
+     /^Warm start: nSinks / {f="3-0-" $4 ".txt"; if (!(f in seen)) {printf "" > f; seen[f]=1} print head > f; next}
+     f {print > f; next}
+     {head=head "\n" $0}' sweep-3/runs/center-manet-kw-p15-n2-r1/stdout.txt
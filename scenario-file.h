@@ -0,0 +1,198 @@
+#ifndef SCENARIO_FILE_H
+#define SCENARIO_FILE_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//Binary campus layout, read in place through mmap so a layout with many
+//thousands of buildings and nodes costs no parsing at start-up. A file is
+//  ScenarioHeader, ScenarioBuilding[buildings], ScenarioNode[nodes]
+//all little-endian as written by the host. The records are fixed size with
+//their doubles 8-byte aligned, so they are used straight from the mapping.
+//Base stations are the last baseStations nodes, after the building nodes,
+//which keeps the building nodes at the indices sources and sinks come from.
+struct ScenarioHeader
+{
+  char magic[4];          //"SCN1"
+  uint32_t buildings;
+  uint32_t nodes;
+  uint32_t baseStations;
+  double bounds[6];       //xMin, xMax, yMin, yMax, zMin, zMax of the campus
+};
+
+struct ScenarioBuilding
+{
+  double box[6];          //xMin, xMax, yMin, yMax, zMin, zMax
+  uint8_t type;           //Building::BuildingType_t
+  uint8_t walls;          //Building::ExtWallsType_t
+  uint16_t floors;
+  uint16_t roomsX;
+  uint16_t roomsY;
+};
+
+struct ScenarioNode
+{
+  enum Mobility { FIXED = 0, WALK = 1 };
+  //Same bits as NodeInfo::Role
+  enum Role { RELAY = 4, BASE_STATION = 8 };
+
+  double position[3];
+  double walk[4];         //xMin, xMax, yMin, yMax of the random walk
+  double speed;           //m/s of the random walk
+  int32_t building;       //-1 outside any building
+  uint8_t mobility;
+  uint8_t roles;
+  uint16_t reserved;
+  uint32_t reserved2;
+};
+
+static_assert (sizeof (ScenarioHeader) == 64, "ScenarioHeader layout");
+static_assert (sizeof (ScenarioBuilding) == 56, "ScenarioBuilding layout");
+static_assert (sizeof (ScenarioNode) == 80, "ScenarioNode layout");
+
+//Collects a layout and writes it as one file. Base station nodes are moved
+//behind the others and the campus bounds are the union of all buildings,
+//node positions and walk areas.
+class ScenarioFileWriter
+{
+public:
+  void AddBuilding (const ScenarioBuilding &building) { m_buildings.push_back (building); }
+  void AddNode (const ScenarioNode &node) { m_nodes.push_back (node); }
+
+  uint32_t GetNBuildings () const { return m_buildings.size (); }
+  uint32_t GetNNodes () const { return m_nodes.size (); }
+
+  bool Write (const std::string &path) const {
+    ScenarioHeader header;
+    std::memset (&header, 0, sizeof (header));
+    std::memcpy (header.magic, "SCN1", 4);
+    header.buildings = m_buildings.size ();
+    header.nodes = m_nodes.size ();
+    bool empty = true;
+    for (size_t b = 0; b < m_buildings.size (); b++) {
+      const double *box = m_buildings[b].box;
+      Grow (header.bounds, box[0], box[2], box[4], empty);
+      Grow (header.bounds, box[1], box[3], box[5], empty);
+    }
+    std::vector<ScenarioNode> baseStations;
+    for (size_t i = 0; i < m_nodes.size (); i++) {
+      const ScenarioNode &n = m_nodes[i];
+      Grow (header.bounds, n.position[0], n.position[1], n.position[2], empty);
+      if (n.mobility == ScenarioNode::WALK) {
+        Grow (header.bounds, n.walk[0], n.walk[2], n.position[2], empty);
+        Grow (header.bounds, n.walk[1], n.walk[3], n.position[2], empty);
+      }
+      if (n.roles & ScenarioNode::BASE_STATION) {
+        baseStations.push_back (n);
+      }
+    }
+    header.baseStations = baseStations.size ();
+
+    std::ofstream out (path.c_str (), std::ios::binary | std::ios::trunc);
+    out.write ((const char *)&header, sizeof (header));
+    if (!m_buildings.empty ()) {
+      out.write ((const char *)&m_buildings[0], m_buildings.size () * sizeof (ScenarioBuilding));
+    }
+    for (size_t i = 0; i < m_nodes.size (); i++) {
+      if (!(m_nodes[i].roles & ScenarioNode::BASE_STATION)) {
+        out.write ((const char *)&m_nodes[i], sizeof (ScenarioNode));
+      }
+    }
+    if (!baseStations.empty ()) {
+      out.write ((const char *)&baseStations[0], baseStations.size () * sizeof (ScenarioNode));
+    }
+    out.close ();
+    return !out.fail ();
+  }
+
+private:
+  static void Grow (double *bounds, double x, double y, double z, bool &empty) {
+    double v[3] = { x, y, z };
+    for (int a = 0; a < 3; a++) {
+      if (empty || v[a] < bounds[2 * a]) {
+        bounds[2 * a] = v[a];
+      }
+      if (empty || v[a] > bounds[2 * a + 1]) {
+        bounds[2 * a + 1] = v[a];
+      }
+    }
+    empty = false;
+  }
+
+  std::vector<ScenarioBuilding> m_buildings;
+  std::vector<ScenarioNode> m_nodes;
+};
+
+//Read-only mapping of a scenario file. Open checks the magic and that the
+//size matches the counts in the header; the records are then used in place
+//until Close or destruction.
+class ScenarioFile
+{
+public:
+  ScenarioFile () : m_data (0), m_size (0) {}
+  ~ScenarioFile () { Close (); }
+
+  bool Open (const std::string &path) {
+    Close ();
+    int fd = open (path.c_str (), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat (fd, &st) != 0 || st.st_size < (off_t)sizeof (ScenarioHeader)) {
+      close (fd);
+      return false;
+    }
+    void *data = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (data == MAP_FAILED) {
+      return false;
+    }
+    m_data = (const char *)data;
+    m_size = st.st_size;
+    //Records are read once, front to back
+    madvise (data, m_size, MADV_SEQUENTIAL);
+    const ScenarioHeader &h = GetHeader ();
+    if (std::memcmp (h.magic, "SCN1", 4) != 0 || h.baseStations > h.nodes
+        || m_size != sizeof (ScenarioHeader) + (uint64_t)h.buildings * sizeof (ScenarioBuilding)
+                     + (uint64_t)h.nodes * sizeof (ScenarioNode)) {
+      Close ();
+      return false;
+    }
+    return true;
+  }
+
+  void Close () {
+    if (m_data != 0) {
+      munmap ((void *)m_data, m_size);
+    }
+    m_data = 0;
+    m_size = 0;
+  }
+
+  bool IsOpen () const { return m_data != 0; }
+  const ScenarioHeader &GetHeader () const { return *(const ScenarioHeader *)m_data; }
+  const ScenarioBuilding *GetBuildings () const {
+    return (const ScenarioBuilding *)(m_data + sizeof (ScenarioHeader));
+  }
+  const ScenarioNode *GetNodes () const {
+    return (const ScenarioNode *)(GetBuildings () + GetHeader ().buildings);
+  }
+  uint32_t GetNBuildingNodes () const { return GetHeader ().nodes - GetHeader ().baseStations; }
+
+private:
+  ScenarioFile (const ScenarioFile &);
+  ScenarioFile &operator= (const ScenarioFile &);
+
+  const char *m_data;
+  uint64_t m_size;
+};
+
+#endif /* SCENARIO_FILE_H */
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "scenario-file.h"
+
+using namespace std;
+
+//Turns a text layout into an SCN1 scenario file for --scenarioFile (see
+//scenario-file.h). Lines, # starts a comment:
+//  building xMin xMax yMin yMax zMin zMax [type walls floors roomsX roomsY]
+//    type residential|office|commercial, walls wood|windows|concrete|stone
+//  node x y z building fixed|walk [speed] [relay] [base]
+//    building is the 0-based index of an earlier building line or -1;
+//    walk nodes random walk inside their building at speed m/s (1)
+//  grid buildings columns width depth street nodesPerBuilding nSep [speed] [corners] [base]
+//    the campus the scenarios generate from their options: commercial
+//    buildings in snake order, nodes in columns from the corner facing
+//    the center, static corner relays and a base station if asked for
+//Buildings of a grid are numbered after the ones already read.
+
+static const char *g_types[] = { "residential", "office", "commercial" };
+static const char *g_walls[] = { "wood", "windows", "concrete", "stone" };
+
+static bool ParseName (const string &name, const char **names, int n, uint8_t &value) {
+  for (int i = 0; i < n; i++) {
+    if (name == names[i]) {
+      value = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static ScenarioBuilding MakeBuilding (double xMin, double xMax, double yMin, double yMax, double zMin, double zMax) {
+  ScenarioBuilding b;
+  memset (&b, 0, sizeof (b));
+  double box[6] = { xMin, xMax, yMin, yMax, zMin, zMax };
+  copy (box, box + 6, b.box);
+  b.type = 2;
+  b.walls = 1;
+  b.floors = 1;
+  b.roomsX = 1;
+  b.roomsY = 1;
+  return b;
+}
+
+static ScenarioNode MakeNode (double x, double y, int32_t building, const ScenarioBuilding *box) {
+  ScenarioNode n;
+  memset (&n, 0, sizeof (n));
+  n.position[0] = x;
+  n.position[1] = y;
+  n.building = building;
+  n.mobility = ScenarioNode::FIXED;
+  n.speed = 1;
+  if (box != 0) {
+    copy (box->box, box->box + 4, n.walk);
+  }
+  return n;
+}
+
+//Same layout as CampusScenario::Build
+static void AddGrid (ScenarioFileWriter &writer, vector<ScenarioBuilding> &buildings,
+                     uint32_t count, uint32_t columns, double width, double depth, double street,
+                     uint32_t perBuilding, double nSep, double speed, bool corners, bool base) {
+  uint32_t rows = (count + columns - 1) / columns;
+  double pitchX = width + street, pitchY = depth + street;
+  double xMax = min (count, columns) * pitchX - street, yMax = rows * pitchY - street;
+  double cx = xMax / 2, cy = yMax / 2;
+  uint32_t perColumn = nSep > 0 ? (uint32_t)floor (depth / nSep) + 1 : 1;
+  for (uint32_t b = 0; b < count; b++) {
+    uint32_t row = b / columns, col = b % columns;
+    if (row % 2 == 1) {
+      col = columns - 1 - col;
+    }
+    double x = col * pitchX, y = row * pitchY;
+    ScenarioBuilding building = MakeBuilding (x, x + width, y, y + depth, 0, 10);
+    int32_t index = buildings.size ();
+    buildings.push_back (building);
+    writer.AddBuilding (building);
+
+    bool left = fabs (x - cx) < fabs (x + width - cx);
+    bool bottom = fabs (y - cy) < fabs (y + depth - cy);
+    double x0 = left ? x : x + width, dx = left ? nSep : -nSep;
+    double y0 = bottom ? y : y + depth, dy = bottom ? nSep : -nSep;
+    for (uint32_t i = 0; i < perBuilding; i++) {
+      double nx = min (max (x0 + (i / perColumn) * dx, x), x + width);
+      ScenarioNode node = MakeNode (nx, y0 + (i % perColumn) * dy, index, &building);
+      if (i == 0 && corners) {
+        node.roles = ScenarioNode::RELAY;
+      } else {
+        node.mobility = ScenarioNode::WALK;
+        node.speed = speed;
+      }
+      writer.AddNode (node);
+    }
+  }
+  if (base) {
+    double bx = max (1.0, floor ((cx + street / 2) / pitchX + 0.5)) * pitchX - street / 2;
+    double by = max (1.0, floor ((cy + street / 2) / pitchY + 0.5)) * pitchY - street / 2;
+    ScenarioNode node = MakeNode (bx, by, -1, 0);
+    node.roles = ScenarioNode::BASE_STATION;
+    writer.AddNode (node);
+  }
+}
+
+int main (int argc, char *argv[]) {
+  if (argc != 3) {
+    cerr << "usage: scenario-write <layout.txt|-> <out.scn>\n";
+    return 1;
+  }
+  ifstream file;
+  if (string (argv[1]) != "-") {
+    file.open (argv[1]);
+    if (!file) {
+      cerr << "cannot open " << argv[1] << "\n";
+      return 1;
+    }
+  }
+  istream &in = file.is_open () ? file : cin;
+
+  ScenarioFileWriter writer;
+  vector<ScenarioBuilding> buildings;
+  string line;
+  for (int number = 1; getline (in, line); number++) {
+    line = line.substr (0, line.find ('#'));
+    istringstream words (line);
+    string kind;
+    if (!(words >> kind)) {
+      continue;
+    }
+    bool ok = false;
+    if (kind == "building") {
+      double v[6];
+      ok = bool (words >> v[0] >> v[1] >> v[2] >> v[3] >> v[4] >> v[5]);
+      ScenarioBuilding b = MakeBuilding (v[0], v[1], v[2], v[3], v[4], v[5]);
+      string type, walls;
+      if (ok && words >> type >> walls) {
+        ok = ParseName (type, g_types, 3, b.type) && ParseName (walls, g_walls, 4, b.walls)
+             && words >> b.floors >> b.roomsX >> b.roomsY;
+      }
+      if (ok) {
+        buildings.push_back (b);
+        writer.AddBuilding (b);
+      }
+    } else if (kind == "node") {
+      double x, y, z;
+      int32_t building;
+      string mode;
+      ok = bool (words >> x >> y >> z >> building >> mode) && building < (int32_t)buildings.size ()
+           && (mode == "fixed" || (mode == "walk" && building >= 0));
+      if (ok) {
+        ScenarioNode n = MakeNode (x, y, building, building >= 0 ? &buildings[building] : 0);
+        n.position[2] = z;
+        n.mobility = mode == "walk" ? ScenarioNode::WALK : ScenarioNode::FIXED;
+        string word;
+        while (ok && words >> word) {
+          if (word == "relay") {
+            n.roles |= ScenarioNode::RELAY;
+          } else if (word == "base") {
+            n.roles |= ScenarioNode::BASE_STATION;
+          } else {
+            ok = bool (istringstream (word) >> n.speed);
+          }
+        }
+        writer.AddNode (n);
+      }
+    } else if (kind == "grid") {
+      uint32_t count, columns, perBuilding;
+      double width, depth, street, nSep, speed = 1;
+      ok = bool (words >> count >> columns >> width >> depth >> street >> perBuilding >> nSep) && columns > 0;
+      bool corners = false, base = false;
+      string word;
+      while (ok && words >> word) {
+        if (word == "corners") {
+          corners = true;
+        } else if (word == "base") {
+          base = true;
+        } else {
+          ok = bool (istringstream (word) >> speed);
+        }
+      }
+      if (ok) {
+        AddGrid (writer, buildings, count, columns, width, depth, street, perBuilding, nSep, speed, corners, base);
+      }
+    }
+    if (!ok) {
+      cerr << "bad line " << number << ": " << line << "\n";
+      return 1;
+    }
+  }
+  if (!writer.Write (argv[2])) {
+    cerr << "cannot write " << argv[2] << "\n";
+    return 1;
+  }
+  cout << writer.GetNBuildings () << " buildings, " << writer.GetNNodes () << " nodes\n";
+  return 0;
+}
@@ -0,0 +1,136 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#if defined (__AVX2__)
+#include <immintrin.h>
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//Array kernels for the batch path-loss code. AVX2 is used when the build
+//enables it (e.g. CXXFLAGS="-O3 -march=native"), SSE2 on any other x86-64
+//build and a plain loop elsewhere. The vector log10 reduces the argument to
+//m * 2^e with m in [sqrt(1/2), sqrt(2)) and sums the atanh series of
+//(m-1)/(m+1), which stays within a few ulp of std::log10 for positive,
+//normal inputs.
+
+namespace simd {
+
+//atanh series coefficients 1/3, 1/5, ... 1/17
+static const double kLogC[8] = {
+  1.0 / 3, 1.0 / 5, 1.0 / 7, 1.0 / 9, 1.0 / 11, 1.0 / 13, 1.0 / 15, 1.0 / 17
+};
+static const double kLn2 = 0.693147180559945309417;
+static const double kInvLn10 = 0.434294481903251827651;
+static const double kTwo52 = 4503599627370496.0;
+
+inline const char *Name () {
+#if defined (__AVX2__)
+  return "avx2";
+#elif defined (__SSE2__)
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+#if defined (__AVX2__)
+inline __m256d Log10Pd (__m256d x) {
+  __m256i bits = _mm256_castpd_si256 (x);
+  __m256d m = _mm256_castsi256_pd (_mm256_or_si256 (_mm256_and_si256 (bits, _mm256_set1_epi64x (0x000fffffffffffffLL)),
+                                                    _mm256_set1_epi64x (0x3ff0000000000000LL)));
+  //exponent field as a double via the 2^52 trick, then unbias
+  __m256d e = _mm256_sub_pd (_mm256_castsi256_pd (_mm256_or_si256 (_mm256_srli_epi64 (bits, 52),
+                                                                   _mm256_set1_epi64x (0x4330000000000000LL))),
+                             _mm256_set1_pd (kTwo52 + 1023));
+  __m256d big = _mm256_cmp_pd (m, _mm256_set1_pd (M_SQRT2), _CMP_GT_OQ);
+  m = _mm256_blendv_pd (m, _mm256_mul_pd (m, _mm256_set1_pd (0.5)), big);
+  e = _mm256_add_pd (e, _mm256_and_pd (big, _mm256_set1_pd (1.0)));
+  __m256d s = _mm256_div_pd (_mm256_sub_pd (m, _mm256_set1_pd (1.0)), _mm256_add_pd (m, _mm256_set1_pd (1.0)));
+  __m256d s2 = _mm256_mul_pd (s, s);
+  __m256d p = _mm256_set1_pd (kLogC[7]);
+  for (int k = 6; k >= 0; k--) {
+    p = _mm256_add_pd (_mm256_mul_pd (p, s2), _mm256_set1_pd (kLogC[k]));
+  }
+  p = _mm256_add_pd (_mm256_mul_pd (p, s2), _mm256_set1_pd (1.0));
+  __m256d ln = _mm256_add_pd (_mm256_mul_pd (_mm256_mul_pd (s, _mm256_set1_pd (2.0)), p),
+                              _mm256_mul_pd (e, _mm256_set1_pd (kLn2)));
+  return _mm256_mul_pd (ln, _mm256_set1_pd (kInvLn10));
+}
+#elif defined (__SSE2__)
+inline __m128d Log10Pd (__m128d x) {
+  __m128i bits = _mm_castpd_si128 (x);
+  __m128d m = _mm_castsi128_pd (_mm_or_si128 (_mm_and_si128 (bits, _mm_set1_epi64x (0x000fffffffffffffLL)),
+                                              _mm_set1_epi64x (0x3ff0000000000000LL)));
+  __m128d e = _mm_sub_pd (_mm_castsi128_pd (_mm_or_si128 (_mm_srli_epi64 (bits, 52),
+                                                          _mm_set1_epi64x (0x4330000000000000LL))),
+                          _mm_set1_pd (kTwo52 + 1023));
+  __m128d big = _mm_cmpgt_pd (m, _mm_set1_pd (M_SQRT2));
+  m = _mm_or_pd (_mm_and_pd (big, _mm_mul_pd (m, _mm_set1_pd (0.5))), _mm_andnot_pd (big, m));
+  e = _mm_add_pd (e, _mm_and_pd (big, _mm_set1_pd (1.0)));
+  __m128d s = _mm_div_pd (_mm_sub_pd (m, _mm_set1_pd (1.0)), _mm_add_pd (m, _mm_set1_pd (1.0)));
+  __m128d s2 = _mm_mul_pd (s, s);
+  __m128d p = _mm_set1_pd (kLogC[7]);
+  for (int k = 6; k >= 0; k--) {
+    p = _mm_add_pd (_mm_mul_pd (p, s2), _mm_set1_pd (kLogC[k]));
+  }
+  p = _mm_add_pd (_mm_mul_pd (p, s2), _mm_set1_pd (1.0));
+  __m128d ln = _mm_add_pd (_mm_mul_pd (_mm_mul_pd (s, _mm_set1_pd (2.0)), p),
+                           _mm_mul_pd (e, _mm_set1_pd (kLn2)));
+  return _mm_mul_pd (ln, _mm_set1_pd (kInvLn10));
+}
+#endif
+
+//log10 of n positive, normal doubles
+inline void Log10 (const double *in, double *out, size_t n) {
+  size_t i = 0;
+#if defined (__AVX2__)
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd (out + i, Log10Pd (_mm256_loadu_pd (in + i)));
+  }
+#elif defined (__SSE2__)
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd (out + i, Log10Pd (_mm_loadu_pd (in + i)));
+  }
+#endif
+  for (; i < n; i++) {
+    out[i] = std::log10 (in[i]);
+  }
+}
+
+//Squared distance from (x0, y0, z0) to each of the n points x[i], y[i], z[i]
+inline void Distance2 (double x0, double y0, double z0,
+                       const double *x, const double *y, const double *z,
+                       double *out, size_t n) {
+  size_t i = 0;
+#if defined (__AVX2__)
+  __m256d vx = _mm256_set1_pd (x0), vy = _mm256_set1_pd (y0), vz = _mm256_set1_pd (z0);
+  for (; i + 4 <= n; i += 4) {
+    __m256d dx = _mm256_sub_pd (_mm256_loadu_pd (x + i), vx);
+    __m256d dy = _mm256_sub_pd (_mm256_loadu_pd (y + i), vy);
+    __m256d dz = _mm256_sub_pd (_mm256_loadu_pd (z + i), vz);
+    _mm256_storeu_pd (out + i, _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (dx, dx), _mm256_mul_pd (dy, dy)),
+                                              _mm256_mul_pd (dz, dz)));
+  }
+#elif defined (__SSE2__)
+  __m128d vx = _mm_set1_pd (x0), vy = _mm_set1_pd (y0), vz = _mm_set1_pd (z0);
+  for (; i + 2 <= n; i += 2) {
+    __m128d dx = _mm_sub_pd (_mm_loadu_pd (x + i), vx);
+    __m128d dy = _mm_sub_pd (_mm_loadu_pd (y + i), vy);
+    __m128d dz = _mm_sub_pd (_mm_loadu_pd (z + i), vz);
+    _mm_storeu_pd (out + i, _mm_add_pd (_mm_add_pd (_mm_mul_pd (dx, dx), _mm_mul_pd (dy, dy)),
+                                        _mm_mul_pd (dz, dz)));
+  }
+#endif
+  for (; i < n; i++) {
+    double dx = x[i] - x0, dy = y[i] - y0, dz = z[i] - z0;
+    out[i] = dx * dx + dy * dy + dz * dz;
+  }
+}
+
+} // namespace simd
+
+#endif /* SIMD_MATH_H */
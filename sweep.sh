@@ -0,0 +1,163 @@
+#!/bin/bash
+# Runs a grid of MANET scenarios on every core and merges the outputs.
+# Run from the ns-3 top directory (same place as run1.sh/run2.sh/run3.sh).
+#
+# ./sweep.sh [-s scenarios] [-k nSinks] [-p powers] [-n nSeps] [-r seeds]
+#            [-j jobs] [-o outdir] [-w nSinksList] [-c cachedir] [-C] [-B]
+#
+# Each list is space separated, e.g. -s "corner-manet center-manet" -k "1 2 3".
+# -w "1,2,3" replaces -k with warm-start runs: each run simulates the routing
+# warm-up once and forks one branch per nSinks value (tag k"w").
+# Per-run outputs go to <outdir>/runs/<tag>/, the merged result set to
+# <outdir>/index.csv (one row per run) and <outdir>/results.csv (every
+# throughput row tagged with its RunId).
+#
+# Finished runs are cached in <cachedir> (default sweep-cache), keyed by a
+# hash of the scenario binary, the ns-3 libraries, every argument and the
+# RngRun. Runs already in the cache are copied instead of simulated, so
+# re-running a sweep only computes the missing cells and an interrupted
+# sweep picks up where it stopped. A run is written to a temporary
+# directory and only renamed into the cache once it exits cleanly; the
+# .tmp.* directories of killed runs can be deleted. -C ignores the cache.
+
+SCENARIOS="manet corner-manet center-manet"
+SINKS="1 2 3 4 5"
+POWERS="15"
+SEPS="2"
+SEEDS="1"
+JOBS=$(nproc 2>/dev/null || echo 1)
+OUT="sweep"
+BUILD=1
+WARM=""
+CACHE="sweep-cache"
+
+while getopts "s:k:p:n:r:j:o:w:c:CB" opt; do
+  case $opt in
+    s) SCENARIOS=$OPTARG ;;
+    k) SINKS=$OPTARG ;;
+    p) POWERS=$OPTARG ;;
+    n) SEPS=$OPTARG ;;
+    r) SEEDS=$OPTARG ;;
+    j) JOBS=$OPTARG ;;
+    o) OUT=$OPTARG ;;
+    w) WARM=$OPTARG ;;
+    c) CACHE=$OPTARG ;;
+    C) CACHE="" ;;
+    B) BUILD=0 ;;
+    *) echo "usage: $0 [-s scenarios] [-k nSinks] [-p powers] [-n nSeps] [-r seeds] [-j jobs] [-o outdir] [-w nSinksList] [-c cachedir] [-C] [-B]" >&2
+       exit 1 ;;
+  esac
+done
+
+#build once instead of letting every ./waf --run re-check the tree
+if [ $BUILD -eq 1 ]; then
+  ./waf build || exit 1
+fi
+
+#scratch programs are either build/scratch/<name> or ns3.XX-<name>-<profile>
+find_binary () {
+  local b
+  for b in build/scratch/$1 build/scratch/ns3*-$1-*; do
+    if [ -x "$b" ] && [ -f "$b" ]; then
+      echo "$PWD/$b"
+      return 0
+    fi
+  done
+  return 1
+}
+
+export LD_LIBRARY_PATH="$PWD/build/lib${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}"
+mkdir -p "$OUT/runs"
+OUT=$(cd "$OUT" && pwd)
+if [ -n "$CACHE" ]; then
+  mkdir -p "$CACHE"
+  CACHE=$(cd "$CACHE" && pwd)
+  #the binaries link against the ns-3 libraries, so those are part of every key
+  LIBHASH=$(cat build/lib/*.so 2>/dev/null | sha256sum | cut -d' ' -f1)
+fi
+
+if [ -n "$WARM" ]; then
+  SINKS="w"
+fi
+
+JOBLIST="$OUT/jobs.txt"
+: > "$JOBLIST"
+for s in $SCENARIOS; do
+  bin=$(find_binary "$s") || { echo "no binary for $s, build it first" >&2; exit 1; }
+  binhash=$(sha256sum "$bin" | cut -d' ' -f1)
+  for k in $SINKS; do
+    for p in $POWERS; do
+      for n in $SEPS; do
+        for r in $SEEDS; do
+          echo "$s $bin $k $p $n $r $binhash" >> "$JOBLIST"
+        done
+      done
+    done
+  done
+done
+
+#one run per job, in its own directory so the output files do not collide
+run_one () {
+  local s=$1 bin=$2 k=$3 p=$4 n=$5 r=$6 binhash=$7
+  local tag="$s-k$k-p$p-n$n-r$r"
+  local dir="$OUT/runs/$tag"
+  local sinks="--nSinks=$k"
+  if [ "$k" = "w" ]; then
+    sinks="--nSinksList=$WARM"
+  fi
+  local args="$sinks --power=$p --nSep=$n --RngRun=$r --CSVfileName=throughput.csv"
+  rm -rf "$dir"
+  if [ -z "$CACHE" ]; then
+    mkdir -p "$dir"
+    (cd "$dir" && "$bin" $args > stdout.txt 2> stderr.txt)
+    echo $? > "$dir/status"
+    echo "done $tag (exit $(cat "$dir/status"))"
+    return
+  fi
+  local key=$(echo "$binhash $LIBHASH $s $args" | sha256sum | cut -d' ' -f1)
+  local entry="$CACHE/$key"
+  if [ -f "$entry/status" ]; then
+    cp -al "$entry" "$dir" 2>/dev/null || cp -a "$entry" "$dir"
+    echo "cached $tag"
+    return
+  fi
+  local tmp="$CACHE/.tmp.$key.$$"
+  rm -rf "$tmp"
+  mkdir -p "$tmp"
+  (cd "$tmp" && "$bin" $args > stdout.txt 2> stderr.txt)
+  local status=$?
+  echo $status > "$tmp/status"
+  echo "$s $args" > "$tmp/args"
+  if [ $status -eq 0 ]; then
+    #a concurrent sweep may have finished the same key first; either copy is fine
+    mv -T "$tmp" "$entry" 2>/dev/null || rm -rf "$tmp"
+    cp -al "$entry" "$dir" 2>/dev/null || cp -a "$entry" "$dir"
+  else
+    mv -T "$tmp" "$dir"
+  fi
+  echo "done $tag (exit $status)"
+}
+export -f run_one
+export OUT WARM CACHE LIBHASH
+
+echo "running $(wc -l < "$JOBLIST") jobs on $JOBS cores"
+xargs -P "$JOBS" -L 1 bash -c 'run_one "$@"' _ < "$JOBLIST"
+
+#merge per-run outputs into one indexed result set
+echo "RunId,Scenario,NumberOfSinks,TransmissionPower,NodeSeparation,Seed,Status,Directory" > "$OUT/index.csv"
+echo "RunId,Scenario,Seed,SimulationSecond,ReceiveRate,PacketsReceived,NumberOfSinks,RoutingProtocol,TransmissionPower" > "$OUT/results.csv"
+id=0
+while read s bin k p n r binhash; do
+  tag="$s-k$k-p$p-n$n-r$r"
+  dir="$OUT/runs/$tag"
+  sinks=$k
+  if [ "$k" = "w" ]; then
+    sinks=${WARM//,/|}
+  fi
+  echo "$id,$s,$sinks,$p,$n,$r,$(cat "$dir/status" 2>/dev/null || echo missing),runs/$tag" >> "$OUT/index.csv"
+  if [ -f "$dir/throughput.csv" ]; then
+    tail -n +2 "$dir/throughput.csv" | tr -d ' ' | sed "s/^/$id,$s,$r,/" >> "$OUT/results.csv"
+  fi
+  id=$((id+1))
+done < "$JOBLIST"
+echo "merged $id runs into $OUT/index.csv and $OUT/results.csv"
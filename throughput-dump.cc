@@ -0,0 +1,30 @@
+#include <fstream>
+#include <iostream>
+#include "throughput-log.h"
+
+using namespace std;
+
+//Prints a throughput file written with --outputFormat=bin as CSV
+int main (int argc, char *argv[]) {
+  if (argc != 2) {
+    cerr << "usage: throughput-dump <file>\n";
+    return 1;
+  }
+  ifstream in (argv[1], ios::binary);
+  if (!in) {
+    cerr << "cannot open " << argv[1] << "\n";
+    return 1;
+  }
+  cout << "SimulationSecond," << "ReceiveRate," <<
+  "PacketsReceived," << "NumberOfSinks," <<
+  "RoutingProtocol," << "TransmissionPower" << endl;
+  ThroughputLog block;
+  while (block.ReadBlock (in)) {
+    block.WriteCsv (cout);
+  }
+  if (!in.eof ()) {
+    cerr << "bad block in " << argv[1] << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,148 @@
+#ifndef THROUGHPUT_LOG_H
+#define THROUGHPUT_LOG_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//In-memory, column per field buffer for the once-a-second throughput rows
+//of the scenarios. Rows are only written out when blockRows of them have
+//piled up or on Flush (), so a run opens its output file a handful of times
+//instead of once per simulated second.
+//
+//"csv" writes the same text rows CheckThroughput always wrote. "bin" writes
+//self-contained blocks, so shards can be concatenated like the CSV ones:
+//  char magic[4] = "TPB1", uint32_t rows,
+//  double time[rows], double kbps[rows], uint32_t packets[rows],
+//  uint32_t sinks[rows], uint32_t protocol[rows], double power[rows]
+//all little-endian as written by the host. ReadBlock reads one back.
+class ThroughputLog
+{
+public:
+  enum Format { CSV, BINARY };
+
+  ThroughputLog () : m_format (CSV), m_blockRows (4096) {}
+
+  //Parses "csv" or "bin"; returns false for anything else
+  static bool ParseFormat (const std::string &name, Format &format) {
+    if (name == "csv") {
+      format = CSV;
+    } else if (name == "bin") {
+      format = BINARY;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  //Rows already buffered for a previous file are discarded. With
+  //blockRows 0 nothing is written before Flush ().
+  void Open (const std::string &path, Format format, uint32_t blockRows = 4096) {
+    Clear ();
+    m_path = path;
+    m_format = format;
+    m_blockRows = blockRows;
+  }
+
+  //Sends the rows still buffered, and later ones, to another file
+  void SetPath (const std::string &path) { m_path = path; }
+  //Rewrites the sinks column of the rows still buffered
+  void SetSinks (uint32_t sinks) { std::fill (m_sinks.begin (), m_sinks.end (), sinks); }
+
+  void Add (double time, double kbps, uint32_t packets, uint32_t sinks, uint32_t protocol, double power) {
+    m_time.push_back (time);
+    m_kbps.push_back (kbps);
+    m_packets.push_back (packets);
+    m_sinks.push_back (sinks);
+    m_protocol.push_back (protocol);
+    m_power.push_back (power);
+    if (m_blockRows > 0 && m_time.size () >= m_blockRows) {
+      Flush ();
+    }
+  }
+
+  size_t GetN () const { return m_time.size (); }
+
+  //Buffered rows as CSV text, one line per row
+  void WriteCsv (std::ostream &out) const {
+    std::ostringstream text;
+    for (size_t i = 0; i < m_time.size (); i++) {
+      text << m_time[i] << " , " << m_kbps[i] << " , " << m_packets[i] << " , "
+           << m_sinks[i] << " , " << m_protocol[i] << " , " << m_power[i] << "\n";
+    }
+    out << text.str ();
+  }
+
+  //Appends the buffered rows to the file and empties the buffer
+  void Flush () {
+    if (m_time.empty () || m_path.empty ()) {
+      return;
+    }
+    std::ofstream out (m_path.c_str (), std::ios::app | std::ios::binary);
+    if (m_format == CSV) {
+      WriteCsv (out);
+    } else {
+      uint32_t rows = m_time.size ();
+      out.write ("TPB1", 4);
+      out.write ((const char *)&rows, sizeof (rows));
+      Write (out, m_time);
+      Write (out, m_kbps);
+      Write (out, m_packets);
+      Write (out, m_sinks);
+      Write (out, m_protocol);
+      Write (out, m_power);
+    }
+    out.close ();
+    Clear ();
+  }
+
+  void Clear () {
+    m_time.clear ();
+    m_kbps.clear ();
+    m_packets.clear ();
+    m_sinks.clear ();
+    m_protocol.clear ();
+    m_power.clear ();
+  }
+
+  //Reads one binary block into this buffer; false at end of input or on a bad block
+  bool ReadBlock (std::istream &in) {
+    char magic[4];
+    uint32_t rows = 0;
+    Clear ();
+    if (!in.read (magic, 4) || std::memcmp (magic, "TPB1", 4) != 0
+        || !in.read ((char *)&rows, sizeof (rows))) {
+      return false;
+    }
+    return Read (in, m_time, rows) && Read (in, m_kbps, rows) && Read (in, m_packets, rows)
+           && Read (in, m_sinks, rows) && Read (in, m_protocol, rows) && Read (in, m_power, rows);
+  }
+
+private:
+  template <class T>
+  static void Write (std::ostream &out, const std::vector<T> &column) {
+    out.write ((const char *)&column[0], column.size () * sizeof (T));
+  }
+  template <class T>
+  static bool Read (std::istream &in, std::vector<T> &column, uint32_t rows) {
+    column.resize (rows);
+    return rows == 0 || in.read ((char *)&column[0], rows * sizeof (T));
+  }
+
+  std::string m_path;
+  Format m_format;
+  uint32_t m_blockRows;
+  std::vector<double> m_time;
+  std::vector<double> m_kbps;
+  std::vector<uint32_t> m_packets;
+  std::vector<uint32_t> m_sinks;
+  std::vector<uint32_t> m_protocol;
+  std::vector<double> m_power;
+};
+
+#endif /* THROUGHPUT_LOG_H */
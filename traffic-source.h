@@ -0,0 +1,214 @@
+#ifndef TRAFFIC_SOURCE_H
+#define TRAFFIC_SOURCE_H
+
+#include <algorithm>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "packet-pool.h"
+#include "flow-time-tag.h"
+
+namespace ns3 {
+
+//Sends fixed-size packets to one remote address over a socket it owns.
+//Gaps are constant (CBR), exponential with mean Interval (Poisson), or CBR
+//during OnTime periods separated by silent OffTime periods (on/off). One
+//Timer is rescheduled for every packet instead of a new bound event, and
+//the source stops after MaxPackets packets (0 keeps sending until the
+//application or the simulation stops). Packets come from the default
+//PacketPool, so sinks that recycle what they receive feed the sources.
+//With Timestamp set every packet carries a FlowTimeTag for the receivers.
+class TrafficSource : public Application
+{
+public:
+  enum Mode { CBR, POISSON, ONOFF };
+
+  static TypeId GetTypeId (void);
+  TrafficSource ();
+
+  //Parses "cbr", "poisson" or "onoff"; returns false for anything else
+  static bool ParseMode (const std::string &name, Mode &mode);
+  int64_t AssignStreams (int64_t stream);
+  uint32_t GetSent (void) const { return m_sent; }
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+  void Send (void);
+  Time NextGap (void);
+  Ptr<Packet> NewPacket (void);
+
+  Address m_remote;
+  TypeId m_protocol;
+  uint32_t m_size;
+  Time m_interval;
+  uint32_t m_maxPackets;
+  Mode m_mode;
+  uint32_t m_flowId;
+  bool m_timestamp;
+  Ptr<RandomVariableStream> m_onTime;
+  Ptr<RandomVariableStream> m_offTime;
+  Ptr<ExponentialRandomVariable> m_gap;
+  Ptr<Socket> m_socket;
+  Timer m_timer;
+  Time m_onUntil;
+  uint32_t m_sent;
+  TracedCallback<Ptr<const Packet> > m_txTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TrafficSource);
+
+inline TypeId TrafficSource::GetTypeId (void) {
+  static TypeId tid = TypeId ("ns3::TrafficSource")
+    .SetParent<Application> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<TrafficSource> ()
+    .AddAttribute ("Remote", "Destination address of the packets",
+                   AddressValue (),
+                   MakeAddressAccessor (&TrafficSource::m_remote),
+                   MakeAddressChecker ())
+    .AddAttribute ("Protocol", "Socket factory used to send",
+                   TypeIdValue (UdpSocketFactory::GetTypeId ()),
+                   MakeTypeIdAccessor (&TrafficSource::m_protocol),
+                   MakeTypeIdChecker ())
+    .AddAttribute ("PacketSize", "Payload bytes per packet",
+                   UintegerValue (512),
+                   MakeUintegerAccessor (&TrafficSource::m_size),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Interval", "Gap between packets (mean gap for Poisson)",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&TrafficSource::m_interval),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxPackets", "Packets to send, 0 for no limit",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&TrafficSource::m_maxPackets),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Mode", "Gap pattern",
+                   EnumValue (CBR),
+                   MakeEnumAccessor (&TrafficSource::m_mode),
+                   MakeEnumChecker (CBR, "Cbr", POISSON, "Poisson", ONOFF, "OnOff"))
+    .AddAttribute ("FlowId", "Flow index written into the FlowTimeTag",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&TrafficSource::m_flowId),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Timestamp", "Tag every packet with FlowId and its send time",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TrafficSource::m_timestamp),
+                   MakeBooleanChecker ())
+    .AddAttribute ("OnTime", "Length of an on period (OnOff mode)",
+                   StringValue ("ns3::ConstantRandomVariable[Constant=1.0]"),
+                   MakePointerAccessor (&TrafficSource::m_onTime),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddAttribute ("OffTime", "Length of an off period (OnOff mode)",
+                   StringValue ("ns3::ConstantRandomVariable[Constant=1.0]"),
+                   MakePointerAccessor (&TrafficSource::m_offTime),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddTraceSource ("Tx", "A packet was handed to the socket",
+                     MakeTraceSourceAccessor (&TrafficSource::m_txTrace),
+                     "ns3::Packet::TracedCallback");
+  return tid;
+}
+
+inline TrafficSource::TrafficSource ()
+  : m_size (512),
+    m_maxPackets (0),
+    m_mode (CBR),
+    m_flowId (0),
+    m_timestamp (false),
+    m_timer (Timer::CANCEL_ON_DESTROY),
+    m_sent (0)
+{
+  m_gap = CreateObject<ExponentialRandomVariable> ();
+  m_timer.SetFunction (&TrafficSource::Send, this);
+}
+
+inline bool TrafficSource::ParseMode (const std::string &name, Mode &mode) {
+  if (name == "cbr") {
+    mode = CBR;
+  } else if (name == "poisson") {
+    mode = POISSON;
+  } else if (name == "onoff") {
+    mode = ONOFF;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+inline int64_t TrafficSource::AssignStreams (int64_t stream) {
+  m_gap->SetStream (stream);
+  m_onTime->SetStream (stream + 1);
+  m_offTime->SetStream (stream + 2);
+  return 3;
+}
+
+inline void TrafficSource::DoDispose (void) {
+  m_timer.Cancel ();
+  m_socket = 0;
+  m_onTime = 0;
+  m_offTime = 0;
+  m_gap = 0;
+  Application::DoDispose ();
+}
+
+inline void TrafficSource::StartApplication (void) {
+  if (m_socket == 0) {
+    m_socket = Socket::CreateSocket (GetNode (), m_protocol);
+    m_socket->Bind ();
+    m_socket->Connect (m_remote);
+  }
+  m_sent = 0;
+  m_onUntil = Simulator::Now () + Seconds (m_onTime->GetValue ());
+  Send ();
+}
+
+inline void TrafficSource::StopApplication (void) {
+  m_timer.Cancel ();
+  if (m_socket != 0) {
+    m_socket->Close ();
+  }
+}
+
+inline Ptr<Packet> TrafficSource::NewPacket (void) {
+  return PacketPool::Default ().Allocate (m_size);
+}
+
+inline Time TrafficSource::NextGap (void) {
+  switch (m_mode) {
+    case POISSON:
+      return Seconds (m_gap->GetValue (m_interval.GetSeconds (), 0));
+    case ONOFF:
+      if (Simulator::Now () + m_interval >= m_onUntil) {
+        //Rest of this on period, the off period, then the next on period
+        Time off = Seconds (m_offTime->GetValue ());
+        Time gap = std::max (m_onUntil - Simulator::Now (), Time (0)) + off;
+        m_onUntil = Simulator::Now () + gap + Seconds (m_onTime->GetValue ());
+        return gap;
+      }
+      return m_interval;
+    default:
+      return m_interval;
+  }
+}
+
+inline void TrafficSource::Send (void) {
+  Ptr<Packet> packet = NewPacket ();
+  if (m_timestamp) {
+    packet->AddPacketTag (FlowTimeTag (m_flowId, Simulator::Now ()));
+  }
+  m_txTrace (packet);
+  m_socket->Send (packet);
+  m_sent++;
+  if (m_maxPackets > 0 && m_sent >= m_maxPackets) {
+    m_socket->Close ();
+    return;
+  }
+  m_timer.Schedule (NextGap ());
+}
+
+} // namespace ns3
+
+#endif /* TRAFFIC_SOURCE_H */